@@ -2,11 +2,16 @@
 #include <GLFW/glfw3.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#ifdef _WIN32
 #include <direct.h>
+#endif
 
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include "FrameCapture.h"
+#include "LightBaker.h"
+#include "RenderStats.h"
+#include "SceneKernels.h"
+#include "SkyIrradiance.h"
+#include "SoftRasterizer.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -19,29 +24,61 @@
 #include <string>
 #include <map>
 #include <algorithm> // std::max
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 //--------------------------------------------------------------
 // Forward declarations
 //--------------------------------------------------------------
 static void framebuffer_size_callback(GLFWwindow*, int w, int h);
+static void window_refresh_callback(GLFWwindow* window);
 static void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 static void processInput(GLFWwindow* window);
 static glm::vec3 screenToWorldRay(GLFWwindow* window, const glm::mat4& projection, const glm::mat4& view);
-static bool raySphereIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDir, const glm::vec3& sphereCenter, float sphereRadius);
 
 static std::string readTextFile(const char* path);
-static GLuint compileShaderFromFile(GLenum type, const char* path);
-static GLuint createProgram(const char* vsPath, const char* fsPath);
+static GLuint compileShaderFromFile(GLenum type, const char* path, const std::string& defines = std::string());
+static GLuint createProgram(const char* vsPath, const char* fsPath, const std::string& defines = std::string());
 
-static GLuint loadTexture2D(const char* path);
 static GLuint loadCubemap(const std::vector<std::string>& faces);
-
-static std::vector<float> buildGridFloor(int halfSize, float cellSize, float y, float r, float g, float b);
+static std::vector<std::string> skyboxFaces();
+static void computeSkyAmbient(const SkyFace faces[6]);
+
+struct SceneTarget;
+struct GpuFrameTimer;
+static void resizeSceneTarget(SceneTarget& t, int w, int h);
+static void destroySceneTarget(SceneTarget& t);
+static void initGpuFrameTimer(GpuFrameTimer& t);
+static bool beginGpuFrameTimer(GpuFrameTimer& t);
+static void endGpuFrameTimer(GpuFrameTimer& t);
+static bool pollGpuFrameTimer(GpuFrameTimer& t, float& outMs);
+static void updateRenderScale(float gpuFrameMs);
+
+static bool keyDown(GLFWwindow* window, int key);
+static bool startInputRecording(GLFWwindow* window, const char* path);
+static bool finishInputRecording();
+static bool loadInputReplay(const char* path);
+static void applyInitialState(GLFWwindow* window);
+static bool advanceInputReplay(GLFWwindow* window);
+static bool writeFrameStats(const char* path, const std::vector<float>& frameMs);
+static int compareFrameStats(const char* baselinePath, const char* currentPath, float threshold);
 
  
-static bool loadSwordToGPU(const char* path);
-static void drawSword(GLuint program);
+static bool loadSwordMeshes(const char* path);
+static bool uploadSwordToGPU();
+struct SceneFrameUniforms;
+static void drawSword(unsigned features, const SceneFrameUniforms& frame);
+static void computeStaticAmbientOcclusion();
+static void bakeStaticAmbientOcclusion();
+
+static glm::mat4 swordModelMatrix();
+static glm::vec3 currentLightPos();
+static void currentSpecular(float& strength, float& shininess);
+static int runSoftwareRenderer(const char* outPath, int width, int height, int frames, const char* statsPath);
  
 static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 
@@ -49,6 +86,10 @@ static void mouse_button_callback(GLFWwindow* window, int button, int action, in
 static float gLightRadius = 16.0f;   // bigger circle
 static float gLightSpeed = 0.35f;   // smaller = slower
 static float gLightHeight = 7.0f;
+static glm::vec3 gLightColor(1.9f, 1.4f, 1.2f);
+static float gAmbientStrength = 0.18f;
+static glm::vec3 gAmbientSH[9] = { gLightColor }; // sky irradiance; flat light colour until the skybox loads
+static glm::vec3 gClearColor(0.05f, 0.06f, 0.08f);
 
 //----------------------------------------------------------
 //  GLOBAL STATE (inputs / toggles / camera / scene objects)
@@ -64,6 +105,18 @@ static bool gObjectMode = false;
 static bool gWireframe = false;
 static bool gShowGrid = true;
 static bool gUseBlinn = true;
+static bool gParticlesEnabled = true; // F5, only matters with --particles
+static int gParticleCount = 0;        // --particles; 0 once init fails, so it is what actually runs
+static int gSwordFieldCount = 0;      // --sword-field, same rule
+
+//---------------------------
+// Floor
+//---------------------------
+// The GL floor is generated in the vertex shader around the camera (no
+// vertex buffer); the software backend builds a patch around it once.
+static float gFloorHalfSize = 500.0f; // reaches the far plane
+static int gFloorCells = 32;          // per side; lighting is per fragment, cells only bound interpolation error
+static glm::vec3 gFloorColor(0.6f, 0.6f, 0.65f);
 
 //---------------------------
 // Time
@@ -71,6 +124,43 @@ static bool gUseBlinn = true;
 static float gDeltaTime = 0.0f;
 static float gLastFrame = 0.0f;
 
+//---------------------------
+// Dynamic resolution
+//---------------------------
+static bool  gDynamicRes = false;
+static float gRenderScale = 1.0f;     // fraction of framebuffer width/height the scene renders at
+static float gTargetFrameMs = 16.6f;  // GPU frame time the controller steers towards
+static float gMinRenderScale = 0.5f;
+static float gMaxRenderScale = 1.0f;
+static float gUpscaleSharpness = 0.25f; // 0 = plain bilinear
+static float gGpuFrameMsAvg = 0.0f;
+
+//---------------------------
+// Render on demand
+//---------------------------
+static bool gRenderOnDemand = false;
+static bool gSceneDirty = true;    // something visible changed since the last presented frame
+static bool gInputHeld = false;    // a movement key is down, keep producing frames
+static bool gLightPaused = false;
+static float gLightTime = 0.0f;    // only advances while the light animates
+static double gIdleWaitSeconds = 0.5;
+
+//---------------------------
+// Input record / replay
+//---------------------------
+enum InputMode { INPUT_LIVE, INPUT_RECORD, INPUT_REPLAY };
+static InputMode gInputMode = INPUT_LIVE;
+static float gReplayDeltaTime = 1.0f / 60.0f; // fixed simulation step while replaying
+static bool gReplayDispatching = false;       // callbacks are being fed from the replay file
+
+enum InputEventType : uint8_t {
+    INPUT_EV_KEYS = 0,
+    INPUT_EV_CURSOR = 1,
+    INPUT_EV_SCROLL = 2,
+    INPUT_EV_BUTTON = 3,
+    INPUT_EV_END = 4,
+};
+
 //---------------------------
 // Camera state
 //---------------------------
@@ -105,22 +195,275 @@ static glm::vec3 gSwordLocalCenter(0.0f);
 static glm::vec3 gSwordLocalMin(0.0f);
 static glm::vec3 gSwordLocalMax(0.0f);
 
+//----------------------------------------------------------
+//  SHADER PERMUTATIONS
+//----------------------------------------------------------
+// The scene shader's per-draw switches are compile-time features: each
+// bitmask is compiled once with matching #defines and cached together
+// with its uniform locations. SHADER_UBER is the old runtime-branching
+// shader, kept around for comparison (F4, --uber, --shader-bench).
+// SHADER_INSTANCED (per-instance transform for the GPU-culled sword
+// field) and SHADER_PROCEDURAL_FLOOR (floor generated from gl_VertexID)
+// only change the vertex stage, so the uber shader keeps them too.
+enum ShaderFeature : unsigned {
+    SHADER_BLINN_PHONG      = 1u << 0,
+    SHADER_SELECTED         = 1u << 1,
+    SHADER_USE_TEXTURE      = 1u << 2,
+    SHADER_USE_LIGHTMAP     = 1u << 3,
+    SHADER_INSTANCED        = 1u << 4,
+    SHADER_PROCEDURAL_FLOOR = 1u << 5,
+    SHADER_FEATURE_MASK     = (1u << 6) - 1,
+    SHADER_UBER             = 1u << 6,
+    SHADER_VERTEX_FEATURES  = SHADER_INSTANCED | SHADER_PROCEDURAL_FLOOR,
+};
+
+struct SceneProgram {
+    GLuint id = 0;
+    GLint view = -1, projection = -1, model = -1, normalMatrix = -1;
+    GLint viewPos = -1, lightPos = -1, lightColor = -1;
+    GLint ambient = -1, ambientSH = -1, specStrength = -1, shininess = -1;
+    GLint lightmapFromWorld = -1, lightmapRect = -1;
+    GLint floorPatch = -1, floorCells = -1; // procedural floor only
+    GLint useBlinn = -1, selected = -1, useTexture = -1, useLightmap = -1; // uber only
+    uint64_t frameUploaded = 0; // per-frame uniforms are current for this frame
+};
+
+// everything a scene draw needs that doesn't change within a frame
+struct SceneFrameUniforms {
+    uint64_t frame = 0;
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+    glm::vec3 lightPos = glm::vec3(0.0f);
+    float specStrength = 0.0f;
+    float shininess = 1.0f;
+    glm::mat4 lightmapFromWorld = glm::mat4(1.0f);
+    glm::vec4 lightmapRect = glm::vec4(0.0f);
+};
+
+static std::map<unsigned, SceneProgram> gScenePrograms;
+static bool gUseUberShader = false;
+
+static std::string shaderFeatureDefines(unsigned features)
+{
+    std::string d;
+    if (features & SHADER_INSTANCED)    d += "#define INSTANCED\n";
+    if (features & SHADER_PROCEDURAL_FLOOR) d += "#define PROCEDURAL_FLOOR\n";
+    if (features & SHADER_UBER) return d + "#define UBER_SHADER\n";
+
+    if (features & SHADER_BLINN_PHONG)  d += "#define BLINN_PHONG\n";
+    if (features & SHADER_SELECTED)     d += "#define SELECTED\n";
+    if (features & SHADER_USE_TEXTURE)  d += "#define USE_TEXTURE\n";
+    if (features & SHADER_USE_LIGHTMAP) d += "#define USE_LIGHTMAP\n";
+    return d;
+}
+
+static SceneProgram& sceneProgram(unsigned features)
+{
+    if (features & SHADER_UBER) features &= SHADER_UBER | SHADER_VERTEX_FEATURES;
+
+    auto it = gScenePrograms.find(features);
+    if (it != gScenePrograms.end()) return it->second;
+
+    SceneProgram p;
+    p.id = createProgram("shaders/vertex.glsl", "shaders/fragment.glsl", shaderFeatureDefines(features));
+    p.view = glGetUniformLocation(p.id, "view");
+    p.projection = glGetUniformLocation(p.id, "projection");
+    p.model = glGetUniformLocation(p.id, "model");
+    p.normalMatrix = glGetUniformLocation(p.id, "normalMatrix");
+    p.viewPos = glGetUniformLocation(p.id, "viewPos");
+    p.lightPos = glGetUniformLocation(p.id, "lightPos");
+    p.lightColor = glGetUniformLocation(p.id, "lightColor");
+    p.ambient = glGetUniformLocation(p.id, "ambientStrength");
+    p.ambientSH = glGetUniformLocation(p.id, "uAmbientSH");
+    p.specStrength = glGetUniformLocation(p.id, "specStrength");
+    p.shininess = glGetUniformLocation(p.id, "shininess");
+    p.lightmapFromWorld = glGetUniformLocation(p.id, "uLightmapFromWorld");
+    p.lightmapRect = glGetUniformLocation(p.id, "uLightmapRect");
+    p.floorPatch = glGetUniformLocation(p.id, "uFloorPatch");
+    p.floorCells = glGetUniformLocation(p.id, "uFloorCells");
+    p.useBlinn = glGetUniformLocation(p.id, "useBlinnPhong");
+    p.selected = glGetUniformLocation(p.id, "uSelected");
+    p.useTexture = glGetUniformLocation(p.id, "uUseTexture");
+    p.useLightmap = glGetUniformLocation(p.id, "uUseLightmap");
+
+    // constants, set once per program
+    glUseProgram(p.id);
+    glUniform1f(glGetUniformLocation(p.id, "constantAtt"), 1.0f);
+    glUniform1f(glGetUniformLocation(p.id, "linearAtt"), 0.09f);
+    glUniform1f(glGetUniformLocation(p.id, "quadraticAtt"), 0.032f);
+    glUniform1i(glGetUniformLocation(p.id, "uTexArray"), 0);
+    glUniform1i(glGetUniformLocation(p.id, "uLightmap"), 2);
+
+    return gScenePrograms[features] = p;
+}
+
+// binds the program for this draw; per-frame uniforms are only uploaded
+// the first time a program is used in a frame
+static SceneProgram& useSceneProgram(unsigned features, const SceneFrameUniforms& frame)
+{
+    SceneProgram& p = sceneProgram(gUseUberShader ? (SHADER_UBER | (features & SHADER_VERTEX_FEATURES)) : features);
+    glUseProgram(p.id);
+
+    if (p.frameUploaded != frame.frame) {
+        p.frameUploaded = frame.frame;
+        glUniformMatrix4fv(p.view, 1, GL_FALSE, glm::value_ptr(frame.view));
+        glUniformMatrix4fv(p.projection, 1, GL_FALSE, glm::value_ptr(frame.projection));
+        glUniform3fv(p.viewPos, 1, glm::value_ptr(frame.viewPos));
+        glUniform3fv(p.lightPos, 1, glm::value_ptr(frame.lightPos));
+        glUniform3fv(p.lightColor, 1, glm::value_ptr(gLightColor));
+        glUniform1f(p.ambient, gAmbientStrength);
+        glUniform3fv(p.ambientSH, 9, glm::value_ptr(gAmbientSH[0]));
+        glUniform1f(p.specStrength, frame.specStrength);
+        glUniform1f(p.shininess, frame.shininess);
+        glUniformMatrix4fv(p.lightmapFromWorld, 1, GL_FALSE, glm::value_ptr(frame.lightmapFromWorld));
+        glUniform4fv(p.lightmapRect, 1, glm::value_ptr(frame.lightmapRect));
+    }
+
+    if (gUseUberShader) {
+        glUniform1i(p.useBlinn, (features & SHADER_BLINN_PHONG) ? 1 : 0);
+        glUniform1i(p.selected, (features & SHADER_SELECTED) ? 1 : 0);
+        glUniform1i(p.useTexture, (features & SHADER_USE_TEXTURE) ? 1 : 0);
+        glUniform1i(p.useLightmap, (features & SHADER_USE_LIGHTMAP) ? 1 : 0);
+    }
+    return p;
+}
+
+// compile every variant up front so toggles never hitch mid-frame;
+// the instanced ones only when something draws instanced, the floor
+// ones only in the combinations the floor is drawn with
+static void warmScenePrograms(bool instanced)
+{
+    for (unsigned f = 0; f <= SHADER_FEATURE_MASK; ++f) {
+        if ((f & SHADER_INSTANCED) && (!instanced || (f & SHADER_PROCEDURAL_FLOOR))) continue;
+        if ((f & SHADER_PROCEDURAL_FLOOR) && (f & SHADER_SELECTED)) continue;
+        sceneProgram(f);
+    }
+    sceneProgram(SHADER_UBER);
+    sceneProgram(SHADER_UBER | SHADER_PROCEDURAL_FLOOR);
+    if (instanced) sceneProgram(SHADER_UBER | SHADER_INSTANCED);
+    std::cout << "Scene shader variants compiled: " << gScenePrograms.size() << "\n";
+}
+
+static void destroyScenePrograms()
+{
+    for (auto& kv : gScenePrograms) glDeleteProgram(kv.second.id);
+    gScenePrograms.clear();
+}
+
+//----------------------------------------------------------
+//  MATERIALS (texture arrays)
+//----------------------------------------------------------
+// Every material texture becomes a layer of a GL_TEXTURE_2D_ARRAY; a
+// texture array holds all materials of one size. Meshes carry their layer
+// as attribute 5 (per vertex for the sword, a constant for the grid), so
+// switching material within an array needs no rebind and no new draw.
+struct Material {
+    std::string path;
+    int array = -1; // gMaterialArrays index, -1 = failed to load
+    int layer = 0;
+};
+
+struct MaterialArray {
+    GLuint tex = 0;
+    int width = 0, height = 0;
+    int layers = 0;
+};
+
+static std::vector<Material> gMaterials;
+static std::vector<MaterialArray> gMaterialArrays;
+
+// returns the material id; textures are loaded by buildMaterialArrays()
+static int addMaterial(const char* path)
+{
+    for (size_t i = 0; i < gMaterials.size(); ++i)
+        if (gMaterials[i].path == path) return (int)i;
+
+    Material m;
+    m.path = path;
+    gMaterials.push_back(m);
+    return (int)gMaterials.size() - 1;
+}
+
+static void buildMaterialArrays()
+{
+    stbi_set_flip_vertically_on_load(true);
+
+    // decode everything first, then group by size
+    std::vector<unsigned char*> pixels(gMaterials.size(), nullptr);
+    std::map<std::pair<int, int>, std::vector<size_t>> bySize;
+
+    for (size_t i = 0; i < gMaterials.size(); ++i) {
+        int w, h, channels;
+        pixels[i] = stbi_load(gMaterials[i].path.c_str(), &w, &h, &channels, 4);
+        if (!pixels[i]) {
+            std::cerr << "Failed to load texture: " << gMaterials[i].path << "\n";
+            continue;
+        }
+        bySize[std::make_pair(w, h)].push_back(i);
+    }
+
+    for (const auto& kv : bySize) {
+        MaterialArray a;
+        a.width = kv.first.first;
+        a.height = kv.first.second;
+        a.layers = (int)kv.second.size();
+
+        glGenTextures(1, &a.tex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, a.tex);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, a.width, a.height, a.layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        for (int layer = 0; layer < a.layers; ++layer) {
+            Material& m = gMaterials[kv.second[layer]];
+            m.array = (int)gMaterialArrays.size();
+            m.layer = layer;
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, a.width, a.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels[kv.second[layer]]);
+        }
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+        gMaterialArrays.push_back(a);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    for (unsigned char* p : pixels) if (p) stbi_image_free(p);
+
+    std::cout << "Materials: " << gMaterials.size() << " in " << gMaterialArrays.size() << " texture arrays\n";
+}
+
+static void destroyMaterialArrays()
+{
+    for (auto& a : gMaterialArrays) glDeleteTextures(1, &a.tex);
+    gMaterialArrays.clear();
+}
+
 //----------------------------------------------------------
 //  MODEL LOADING (Assimp)
 //----------------------------------------------------------
-struct ModelVertex {
-    glm::vec3 pos;
-    glm::vec3 normal;
-    glm::vec2 uv;
+// ModelVertex / ModelMeshCPU live in SceneKernels.h; material indexes gMaterials
+
+// consecutive index range drawn with one texture array bound
+struct DrawBatch {
+    int array = -1;          // gMaterialArrays index, -1 = untextured
+    GLsizei indexCount = 0;
+    size_t indexOffset = 0;  // bytes into the EBO
 };
 
-struct ModelMeshGL {
+// all meshes of a model in one VAO, indices grouped by texture array
+struct BatchedMeshGL {
     GLuint VAO = 0, VBO = 0, EBO = 0;
-    int indexCount = 0;
-    GLuint diffuseTex = 0;
+    GLuint layerVBO = 0; // material layer per vertex, attribute 5
+    GLuint aoVBO = 0;    // baked per-vertex AO, attribute 4
+    GLsizei indexCount = 0;
+    std::vector<DrawBatch> batches;
 };
 
-static std::vector<ModelMeshGL> gSwordMeshes;
+static BatchedMeshGL gSwordGL;
+static std::vector<ModelMeshCPU> gSwordCpuMeshes;
 static std::string gSwordDir;
 
 static std::string getDirectory(const std::string& path)
@@ -134,8 +477,12 @@ static std::string getDirectory(const std::string& path)
 //----------------------------------------------------------
 // Sword selection | sword center  
 //----------------------------------------------------------
+static void recordInputEvent(uint8_t type, uint8_t button, uint8_t action, float x, float y);
+
 static void mouse_button_callback(GLFWwindow* window, int button, int action, int)
 {
+    if (gInputMode == INPUT_REPLAY && !gReplayDispatching) return;
+    if (gInputMode == INPUT_RECORD) recordInputEvent(INPUT_EV_BUTTON, (uint8_t)button, (uint8_t)action, 0.0f, 0.0f);
 
     if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) return;
 
@@ -154,26 +501,82 @@ static void mouse_button_callback(GLFWwindow* window, int button, int action, in
         gObjectMode = false;  
        
     }
+    gSceneDirty = true;
 
    
 }
 
-static ModelMeshGL uploadModelMesh(const std::vector<ModelVertex>& verts,
-    const std::vector<unsigned int>& indices)
+//----------------------------------------------------------
+// Load sword
+//----------------------------------------------------------
+// CPU side only (no GL calls), the software backend stops here
+static bool loadSwordMeshes(const char* path)
+{
+    gSwordCpuMeshes.clear();
+
+    glm::vec3 minV(1e9f);
+    glm::vec3 maxV(-1e9f);
+
+    std::string p = path;
+    for (char& c : p) if (c == '\\') c = '/';
+    gSwordDir = getDirectory(p);
+
+    if (!loadModelMeshes(p, gSwordCpuMeshes, minV, maxV)) return false;
+
+    gSwordLocalMin = minV;
+    gSwordLocalMax = maxV;
+
+    return !gSwordCpuMeshes.empty();
+}
+
+// Vertices keep gSwordCpuMeshes order (so gSwordVertexAO lines up);
+// indices are rebased and regrouped so every texture array is one range.
+static bool uploadSwordToGPU()
 {
-    ModelMeshGL m;
-    m.indexCount = (int)indices.size();
+    if (gSwordCpuMeshes.empty()) return false;
+
+    std::vector<ModelVertex> verts;
+    std::vector<float> layers;
+    std::vector<unsigned int> baseVertex;
+    std::map<int, std::vector<size_t>> meshesByArray;
+
+    for (size_t mi = 0; mi < gSwordCpuMeshes.size(); ++mi) {
+        const ModelMeshCPU& cpu = gSwordCpuMeshes[mi];
+        const Material* mat = (cpu.material >= 0) ? &gMaterials[cpu.material] : nullptr;
+
+        baseVertex.push_back((unsigned int)verts.size());
+        verts.insert(verts.end(), cpu.verts.begin(), cpu.verts.end());
+        layers.insert(layers.end(), cpu.verts.size(), mat ? (float)mat->layer : 0.0f);
+        meshesByArray[mat ? mat->array : -1].push_back(mi);
+    }
+
+    std::vector<unsigned int> indices;
+    gSwordGL.batches.clear();
+    for (const auto& kv : meshesByArray) {
+        size_t first = indices.size();
+        for (size_t mi : kv.second)
+            for (unsigned int idx : gSwordCpuMeshes[mi].indices)
+                indices.push_back(idx + baseVertex[mi]);
+
+        DrawBatch b;
+        b.array = kv.first;
+        b.indexCount = (GLsizei)(indices.size() - first);
+        b.indexOffset = first * sizeof(unsigned int);
+        gSwordGL.batches.push_back(b);
+    }
+    gSwordGL.indexCount = (GLsizei)indices.size();
 
-    glGenVertexArrays(1, &m.VAO);
-    glGenBuffers(1, &m.VBO);
-    glGenBuffers(1, &m.EBO);
+    glGenVertexArrays(1, &gSwordGL.VAO);
+    glGenBuffers(1, &gSwordGL.VBO);
+    glGenBuffers(1, &gSwordGL.EBO);
+    glGenBuffers(1, &gSwordGL.layerVBO);
 
-    glBindVertexArray(m.VAO);
+    glBindVertexArray(gSwordGL.VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m.VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, gSwordGL.VBO);
     glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(ModelVertex), verts.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gSwordGL.EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
     // aPos (0)
@@ -192,116 +595,264 @@ static ModelMeshGL uploadModelMesh(const std::vector<ModelVertex>& verts,
     glDisableVertexAttribArray(2);
     glVertexAttrib3f(2, 1.0f, 1.0f, 1.0f);
 
+    // aAO (4) unbaked until bakeStaticAmbientOcclusion() attaches a buffer
+    glDisableVertexAttribArray(4);
+
+    // aLayer (5)
+    glBindBuffer(GL_ARRAY_BUFFER, gSwordGL.layerVBO);
+    glBufferData(GL_ARRAY_BUFFER, layers.size() * sizeof(float), layers.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+    glEnableVertexAttribArray(5);
+
     glBindVertexArray(0);
-    return m;
+
+    std::cout << "Sword uploaded. Meshes=" << gSwordCpuMeshes.size()
+        << " draw batches=" << gSwordGL.batches.size() << "\n";
+    return true;
 }
-//----------------------------------------------------------
-// Load sword
-//----------------------------------------------------------
-static bool loadSwordToGPU(const char* path)
+
+static void drawSword(unsigned features, const SceneFrameUniforms& frame)
 {
-    gSwordMeshes.clear();
+    if (gSwordSelected) glVertexAttrib3f(2, 1.0f, 1.0f, 0.2f);
+    else               glVertexAttrib3f(2, 1.0f, 1.0f, 1.0f);
 
-    glm::vec3 minV(1e9f);
-    glm::vec3 maxV(-1e9f);
+    glm::mat4 model = swordModelMatrix();
+    glm::mat3 normalMatrix = normalMatrixOf(model);
 
-    std::string p = path;
-    for (char& c : p) if (c == '\\') c = '/';
-    gSwordDir = getDirectory(p);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(gSwordGL.VAO);
+
+    // the selection highlight replaces the texture: one draw for everything
+    if (features & SHADER_SELECTED) {
+        SceneProgram& p = useSceneProgram(features, frame);
+        glUniformMatrix4fv(p.model, 1, GL_FALSE, glm::value_ptr(model));
+        glUniformMatrix3fv(p.normalMatrix, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        glDrawElements(GL_TRIANGLES, gSwordGL.indexCount, GL_UNSIGNED_INT, 0);
+    }
+    else {
+        for (const auto& b : gSwordGL.batches)
+        {
+            unsigned f = features;
+            if (b.array >= 0) f |= SHADER_USE_TEXTURE;
 
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(
-        p,
-        aiProcess_Triangulate |
-        aiProcess_GenSmoothNormals |
-        aiProcess_FlipUVs
-    );
+            SceneProgram& p = useSceneProgram(f, frame);
+            glUniformMatrix4fv(p.model, 1, GL_FALSE, glm::value_ptr(model));
+            glUniformMatrix3fv(p.normalMatrix, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+            glBindTexture(GL_TEXTURE_2D_ARRAY, b.array >= 0 ? gMaterialArrays[b.array].tex : 0);
 
-    if (!scene || !scene->mRootNode) {
-        std::cerr << "Assimp failed: " << importer.GetErrorString() << "\n";
-        return false;
+            glDrawElements(GL_TRIANGLES, b.indexCount, GL_UNSIGNED_INT, (void*)b.indexOffset);
+        }
     }
 
-    for (unsigned int mi = 0; mi < scene->mNumMeshes; ++mi) {
-        const aiMesh* mesh = scene->mMeshes[mi];
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
 
-        std::vector<ModelVertex> verts;
-        std::vector<unsigned int> indices;
-        verts.reserve(mesh->mNumVertices);
+//----------------------------------------------------------
+//  SCENE STATE (shared by the GL and software backends)
+//----------------------------------------------------------
+static glm::mat4 swordModelMatrix()
+{
+    return composeModelMatrix(gSwordPos, gSwordYaw, gSwordScale);
+}
 
-        for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-            ModelVertex v{};
+static glm::vec3 currentLightPos()
+{
+    float ang = gLightTime * gLightSpeed;
+    return glm::vec3(gLightRadius * cos(ang), gLightHeight, gLightRadius * sin(ang));
+}
 
-            v.pos = glm::vec3(mesh->mVertices[i].x,
-                mesh->mVertices[i].y,
-                mesh->mVertices[i].z);
+static void currentSpecular(float& strength, float& shininess)
+{
+    if (gUseBlinn) {
+        strength = 2.0f;
+        shininess = 256.0f;
+    }
+    else {
+        strength = 0.8f;
+        shininess = 16.0f;
+    }
+}
 
-            minV = glm::min(minV, v.pos);
-            maxV = glm::max(maxV, v.pos);
+//----------------------------------------------------------
+//  LIGHT BAKING (ambient occlusion)
+//----------------------------------------------------------
+// Bake space is the sword's frame with its XZ translation and yaw taken
+// out. Object mode only slides the sword in XZ and spins it about Y, so
+// the sword's own AO and the contact shadow it leaves on the floor stay
+// valid wherever it is moved; the shader maps floor fragments into bake
+// space with uLightmapFromWorld.
+static GLuint gFloorLightmapTex = 0;
+static glm::vec4 gLightmapRect(0.0f); // bake space minX, minZ, maxX, maxZ
+static std::vector<float> gSwordVertexAO;  // all sword meshes back to back
+static std::vector<float> gFloorLightmapAO; // gLightmapSize^2, row = +Z
+static int gLightmapSize = 256;
+static int gBakeRaysPerSample = 64;
+
+static glm::mat4 swordBakeToWorld()
+{
+    glm::mat4 m(1.0f);
+    m = glm::translate(m, glm::vec3(gSwordPos.x, 0.0f, gSwordPos.z));
+    m = glm::rotate(m, glm::radians(gSwordYaw), glm::vec3(0, 1, 0));
+    return m;
+}
 
-            if (mesh->HasNormals())
-                v.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-            else
-                v.normal = glm::vec3(0, 1, 0);
+// runs the bake unless cache/<name>_<hash>.bin already holds the result
+static void bakeOrLoadAO(const char* name,
+    const std::vector<BakeTriangle>& tris,
+    const std::vector<glm::vec3>& points,
+    const std::vector<glm::vec3>& normals,
+    const BakeSettings& settings,
+    std::vector<float>& ao)
+{
+    uint64_t hash = hashBakeInputs(tris, points, normals, settings);
+    std::string cachePath = bakeCachePath(name, hash);
+    if (loadBakeCache(cachePath, hash, ao) && ao.size() == points.size()) {
+        std::cout << "AO bake '" << name << "' loaded from " << cachePath << "\n";
+        return;
+    }
 
-            if (mesh->mTextureCoords[0])
-                v.uv = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-            else
-                v.uv = glm::vec2(0, 0);
+    auto t0 = std::chrono::steady_clock::now();
+    bakeAmbientOcclusion(tris, points, normals, settings, ao);
+    std::cout << "AO bake '" << name << "': " << points.size() << " samples in "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms\n";
+    saveBakeCache(cachePath, hash, ao);
+}
 
-            verts.push_back(v);
+// fills gSwordVertexAO, gFloorLightmapAO and gLightmapRect without touching GL
+static void computeStaticAmbientOcclusion()
+{
+    gSwordVertexAO.clear();
+    gFloorLightmapAO.clear();
+    if (gSwordCpuMeshes.empty()) return;
+
+    // sword in bake space: keep its height and scale, drop XZ + yaw
+    glm::mat4 toBake(1.0f);
+    toBake = glm::translate(toBake, glm::vec3(0.0f, gSwordPos.y, 0.0f));
+    toBake = glm::scale(toBake, glm::vec3(gSwordScale));
+
+    std::vector<BakeTriangle> tris;
+    std::vector<glm::vec3> points, normals;
+    glm::vec3 bmin(1e9f), bmax(-1e9f);
+
+    for (const auto& mesh : gSwordCpuMeshes) {
+        size_t base = points.size();
+        for (const auto& v : mesh.verts) {
+            glm::vec3 p = glm::vec3(toBake * glm::vec4(v.pos, 1.0f));
+            points.push_back(p);
+            normals.push_back(v.normal);
+            bmin = glm::min(bmin, p);
+            bmax = glm::max(bmax, p);
         }
-
-        for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
-            const aiFace& face = mesh->mFaces[f];
-            for (unsigned int j = 0; j < face.mNumIndices; ++j)
-                indices.push_back(face.mIndices[j]);
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            BakeTriangle t;
+            t.v0 = points[base + mesh.indices[i]];
+            t.v1 = points[base + mesh.indices[i + 1]];
+            t.v2 = points[base + mesh.indices[i + 2]];
+            tris.push_back(t);
         }
-
-        gSwordMeshes.push_back(uploadModelMesh(verts, indices));
     }
 
-    gSwordLocalMin = minV;
-    gSwordLocalMax = maxV;
-
-    std::cout << "Sword uploaded. Meshes=" << gSwordMeshes.size() << "\n";
-
-    return !gSwordMeshes.empty();
+    BakeSettings settings;
+    settings.raysPerSample = gBakeRaysPerSample;
+    settings.maxDistance = 0.25f * glm::length(bmax - bmin);
+
+    // floor plane, so the underside of the sword darkens too
+    float r = glm::length(bmax - bmin) + settings.maxDistance;
+    BakeTriangle f0 = { glm::vec3(-r, 0.0f, -r), glm::vec3(r, 0.0f, -r), glm::vec3(r, 0.0f, r) };
+    BakeTriangle f1 = { glm::vec3(-r, 0.0f, -r), glm::vec3(r, 0.0f, r), glm::vec3(-r, 0.0f, r) };
+    tris.push_back(f0);
+    tris.push_back(f1);
+
+    // per-vertex sword AO
+    bakeOrLoadAO("sword_ao", tris, points, normals, settings, gSwordVertexAO);
+
+    // floor lightmap covering the sword footprint plus the occlusion range
+    int lmSize = gLightmapSize;
+    glm::vec2 lmMin = glm::vec2(bmin.x, bmin.z) - glm::vec2(settings.maxDistance);
+    glm::vec2 lmMax = glm::vec2(bmax.x, bmax.z) + glm::vec2(settings.maxDistance);
+
+    std::vector<glm::vec3> texels, up((size_t)lmSize * lmSize, glm::vec3(0.0f, 1.0f, 0.0f));
+    texels.reserve(up.size());
+    for (int y = 0; y < lmSize; ++y)
+        for (int x = 0; x < lmSize; ++x)
+            texels.push_back(glm::vec3(
+                glm::mix(lmMin.x, lmMax.x, ((float)x + 0.5f) / (float)lmSize),
+                0.0f,
+                glm::mix(lmMin.y, lmMax.y, ((float)y + 0.5f) / (float)lmSize)));
+
+    bakeOrLoadAO("floor_lightmap", tris, texels, up, settings, gFloorLightmapAO);
+
+    gLightmapRect = glm::vec4(lmMin.x, lmMin.y, lmMax.x, lmMax.y);
 }
 
-static void drawSword(GLuint program)
+static void bakeStaticAmbientOcclusion()
 {
-    if (gSwordSelected) glVertexAttrib3f(2, 1.0f, 0.2f, 0.2f);
-    else               glVertexAttrib3f(2, 1.0f, 1.0f, 1.0f);
-
-    GLint useTexLoc = glGetUniformLocation(program, "uUseTexture");
-    GLint texLoc = glGetUniformLocation(program, "uTex");
-
-    glActiveTexture(GL_TEXTURE0);
-    glUniform1i(texLoc, 0);
-    if (gSwordSelected)
-        glVertexAttrib3f(2, 1.0f, 1.0f, 0.2f);  
-    else
-        glVertexAttrib3f(2, 1.0f, 1.0f, 1.0f);  
+    computeStaticAmbientOcclusion();
+    if (gSwordVertexAO.empty()) return;
+
+    if (gSwordGL.VAO) {
+        if (!gSwordGL.aoVBO) glGenBuffers(1, &gSwordGL.aoVBO);
+        glBindVertexArray(gSwordGL.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, gSwordGL.aoVBO);
+        glBufferData(GL_ARRAY_BUFFER, gSwordVertexAO.size() * sizeof(float), gSwordVertexAO.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+        glEnableVertexAttribArray(4);
+        glBindVertexArray(0);
+    }
 
+    int lmSize = gLightmapSize;
+    std::vector<unsigned char> bytes(gFloorLightmapAO.size());
+    for (size_t i = 0; i < gFloorLightmapAO.size(); ++i)
+        bytes[i] = (unsigned char)(glm::clamp(gFloorLightmapAO[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+    if (!gFloorLightmapTex) glGenTextures(1, &gFloorLightmapTex);
+    glBindTexture(GL_TEXTURE_2D, gFloorLightmapTex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, lmSize, lmSize, 0, GL_RED, GL_UNSIGNED_BYTE, bytes.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // edges are unoccluded
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    for (auto& m : gSwordMeshes)
-    {
-        if (m.diffuseTex != 0) {
-            glBindTexture(GL_TEXTURE_2D, m.diffuseTex);
-            glUniform1i(useTexLoc, 1);
-        }
-        else {
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glUniform1i(useTexLoc, 0);
-        }
+//----------------------------------------------------------
+//  SKY AMBIENT (spherical harmonics)
+//----------------------------------------------------------
+// The skybox faces are projected to 9 SH coefficients of diffuse
+// irradiance when they load, cached under cache/ by image hash like the
+// AO bakes. The result is rescaled so its average has the light colour's
+// luminance: the ambient level stays where ambientStrength put it, the
+// sky only decides its tint and direction.
+static void computeSkyAmbient(const SkyFace faces[6])
+{
+    uint64_t hash = hashSkyFaces(faces);
+    std::string cachePath = bakeCachePath("sky_sh", hash);
 
-        glBindVertexArray(m.VAO);
-        glDrawElements(GL_TRIANGLES, m.indexCount, GL_UNSIGNED_INT, 0);
+    std::vector<float> coeffs;
+    if (loadBakeCache(cachePath, hash, coeffs) && coeffs.size() == 27) {
+        std::cout << "Sky irradiance loaded from " << cachePath << "\n";
+    }
+    else {
+        glm::vec3 sh[9];
+        auto t0 = std::chrono::steady_clock::now();
+        if (!projectSkyIrradiance(faces, 0, sh)) return;
+        std::cout << "Sky irradiance projected in "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms\n";
+        coeffs.assign(glm::value_ptr(sh[0]), glm::value_ptr(sh[0]) + 27);
+        saveBakeCache(cachePath, hash, coeffs);
     }
 
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    const glm::vec3 luma(0.2126f, 0.7152f, 0.0722f);
+    glm::vec3 mean(coeffs[0], coeffs[1], coeffs[2]);
+    float skyLuma = glm::dot(mean, luma);
+    if (skyLuma <= 1e-4f) return; // black sky: keep the flat light colour
+
+    float scale = glm::dot(gLightColor, luma) / skyLuma;
+    for (int i = 0; i < 9; ++i)
+        gAmbientSH[i] = glm::vec3(coeffs[i * 3 + 0], coeffs[i * 3 + 1], coeffs[i * 3 + 2]) * scale;
 }
 
 
@@ -320,9 +871,18 @@ static std::string readTextFile(const char* path)
     return ss.str();
 }
 
-static GLuint compileShaderFromFile(GLenum type, const char* path)
+// defines ("#define X\n" lines) go right after #version, which must stay first
+static GLuint compileShaderFromFile(GLenum type, const char* path, const std::string& defines)
 {
     std::string code = readTextFile(path);
+    if (!defines.empty()) {
+        size_t at = 0;
+        if (code.compare(0, 8, "#version") == 0) {
+            at = code.find('\n');
+            at = (at == std::string::npos) ? code.size() : at + 1;
+        }
+        code.insert(at, defines);
+    }
     const char* src = code.c_str();
 
     GLuint shader = glCreateShader(type);
@@ -339,10 +899,10 @@ static GLuint compileShaderFromFile(GLenum type, const char* path)
     return shader;
 }
 
-static GLuint createProgram(const char* vsPath, const char* fsPath)
+static GLuint createProgram(const char* vsPath, const char* fsPath, const std::string& defines)
 {
-    GLuint vs = compileShaderFromFile(GL_VERTEX_SHADER, vsPath);
-    GLuint fs = compileShaderFromFile(GL_FRAGMENT_SHADER, fsPath);
+    GLuint vs = compileShaderFromFile(GL_VERTEX_SHADER, vsPath, defines);
+    GLuint fs = compileShaderFromFile(GL_FRAGMENT_SHADER, fsPath, defines);
 
     GLuint prog = glCreateProgram();
     glAttachShader(prog, vs);
@@ -365,6 +925,18 @@ static GLuint createProgram(const char* vsPath, const char* fsPath)
 //----------------------------------------------------------
 //  TEXTURE LOADING
 //----------------------------------------------------------
+static std::vector<std::string> skyboxFaces()
+{
+    return {
+       "assets/skybox/right.png",
+       "assets/skybox/left.png",
+       "assets/skybox/top.png",
+       "assets/skybox/bottom.png",
+       "assets/skybox/front.png",
+       "assets/skybox/back.png"
+    };
+}
+
 static GLuint loadCubemap(const std::vector<std::string>& faces)
 {
     // order: +X, -X, +Y, -Y, +Z, -Z
@@ -374,28 +946,33 @@ static GLuint loadCubemap(const std::vector<std::string>& faces)
     glGenTextures(1, &texID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, texID);
 
-    int w, h, channels;
-    for (unsigned int i = 0; i < faces.size(); i++)
+    // decoded faces stay alive until the sky ambient has been projected from them
+    SkyFace images[6];
+    for (unsigned int i = 0; i < faces.size() && i < 6; i++)
     {
-        unsigned char* data = stbi_load(faces[i].c_str(), &w, &h, &channels, 0);
+        SkyFace& img = images[i];
+        unsigned char* data = stbi_load(faces[i].c_str(), &img.width, &img.height, &img.channels, 0);
         if (!data) {
             std::cerr << "Cubemap failed to load: " << faces[i] << "\n";
             continue;
         }
+        img.pixels = data;
 
         GLenum format = GL_RGB;
-        if (channels == 1) format = GL_RED;
-        else if (channels == 3) format = GL_RGB;
-        else if (channels == 4) format = GL_RGBA;
+        if (img.channels == 1) format = GL_RED;
+        else if (img.channels == 3) format = GL_RGB;
+        else if (img.channels == 4) format = GL_RGBA;
 
         glTexImage2D(
             GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-            0, format, w, h, 0, format, GL_UNSIGNED_BYTE, data
+            0, format, img.width, img.height, 0, format, GL_UNSIGNED_BYTE, data
         );
-
-        stbi_image_free(data);
     }
 
+    computeSkyAmbient(images);
+    for (SkyFace& img : images)
+        if (img.pixels) stbi_image_free((void*)img.pixels);
+
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
@@ -407,37 +984,129 @@ static GLuint loadCubemap(const std::vector<std::string>& faces)
     return texID;
 }
 
-static GLuint loadTexture2D(const char* path)
-{
-    stbi_set_flip_vertically_on_load(true);
+//----------------------------------------------------------
+//  OFFSCREEN SCENE TARGET + DYNAMIC RESOLUTION
+//----------------------------------------------------------
+// The target is allocated at full framebuffer size; a lower render
+// scale only shrinks the viewport, so changing it never reallocates.
+struct SceneTarget {
+    GLuint fbo = 0;
+    GLuint colorTex = 0;
+    GLuint depthTex = 0;
+    int width = 0, height = 0;
+};
 
-    int w, h, channels;
-    unsigned char* data = stbi_load(path, &w, &h, &channels, 0);
-    if (!data) {
-        std::cerr << "Failed to load texture: " << path << "\n";
-        return 0;
-    }
+static void destroySceneTarget(SceneTarget& t)
+{
+    if (t.depthTex) glDeleteTextures(1, &t.depthTex);
+    if (t.colorTex) glDeleteTextures(1, &t.colorTex);
+    if (t.fbo) glDeleteFramebuffers(1, &t.fbo);
+    t = SceneTarget();
+}
 
-    GLenum format = GL_RGB;
-    if (channels == 1) format = GL_RED;
-    else if (channels == 3) format = GL_RGB;
-    else if (channels == 4) format = GL_RGBA;
+static void resizeSceneTarget(SceneTarget& t, int w, int h)
+{
+    if (w <= 0 || h <= 0) return;
+    if (t.fbo && t.width == w && t.height == h) return;
+    destroySceneTarget(t);
 
-    GLuint tex = 0;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    t.width = w;
+    t.height = h;
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glGenTextures(1, &t.colorTex);
+    glBindTexture(GL_TEXTURE_2D, t.colorTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // depth is sampled by the upscale pass so the skybox can still depth-test at native res
+    glGenTextures(1, &t.depthTex);
+    glBindTexture(GL_TEXTURE_2D, t.depthTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &t.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t.colorTex, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, t.depthTex, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Scene framebuffer incomplete (" << w << "x" << h << ")\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+// GL_TIME_ELAPSED queries in a small ring so results are read a few
+// frames late instead of stalling on the frame that was just submitted.
+static const int kGpuTimerRing = 4;
 
-    stbi_image_free(data);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    return tex;
+struct GpuFrameTimer {
+    GLuint queries[kGpuTimerRing] = {};
+    bool pending[kGpuTimerRing] = {};
+    int next = 0;
+    int oldest = 0;
+    bool active = false;
+};
+
+static void initGpuFrameTimer(GpuFrameTimer& t)
+{
+    glGenQueries(kGpuTimerRing, t.queries);
+}
+
+static bool beginGpuFrameTimer(GpuFrameTimer& t)
+{
+    if (t.pending[t.next]) return false; // ring full, skip timing this frame
+    glBeginQuery(GL_TIME_ELAPSED, t.queries[t.next]);
+    t.active = true;
+    return true;
+}
+
+static void endGpuFrameTimer(GpuFrameTimer& t)
+{
+    if (!t.active) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    t.pending[t.next] = true;
+    t.next = (t.next + 1) % kGpuTimerRing;
+    t.active = false;
+}
+
+static bool pollGpuFrameTimer(GpuFrameTimer& t, float& outMs)
+{
+    bool got = false;
+    while (t.pending[t.oldest]) {
+        GLint available = 0;
+        glGetQueryObjectiv(t.queries[t.oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(t.queries[t.oldest], GL_QUERY_RESULT, &ns);
+        outMs = (float)((double)ns / 1.0e6);
+        got = true;
+
+        t.pending[t.oldest] = false;
+        t.oldest = (t.oldest + 1) % kGpuTimerRing;
+    }
+    return got;
+}
+
+// Fragment cost scales with pixel count (scale^2), so the correction is
+// the square root of the time ratio. Damped, with a dead band so the
+// scale doesn't flicker around the target.
+static void updateRenderScale(float gpuFrameMs)
+{
+    if (gGpuFrameMsAvg <= 0.0f) gGpuFrameMsAvg = gpuFrameMs;
+    gGpuFrameMsAvg += (gpuFrameMs - gGpuFrameMsAvg) * 0.1f;
+
+    float ratio = gTargetFrameMs / std::max(gGpuFrameMsAvg, 0.01f);
+    if (ratio > 0.95f && ratio < 1.05f) return;
+
+    float desired = gRenderScale * std::sqrt(ratio);
+    gRenderScale += (desired - gRenderScale) * 0.2f;
+    gRenderScale = std::min(std::max(gRenderScale, gMinRenderScale), gMaxRenderScale);
 }
 
 //----------------------------------------------------------
@@ -446,10 +1115,19 @@ static GLuint loadTexture2D(const char* path)
 static void framebuffer_size_callback(GLFWwindow*, int w, int h)
 {
     glViewport(0, 0, w, h);
+    gSceneDirty = true;
+}
+
+static void window_refresh_callback(GLFWwindow*)
+{
+    gSceneDirty = true;
 }
 
 static void mouse_callback(GLFWwindow*, double xpos, double ypos)
 {
+    if (gInputMode == INPUT_REPLAY && !gReplayDispatching) return;
+    if (gInputMode == INPUT_RECORD) recordInputEvent(INPUT_EV_CURSOR, 0, 0, (float)xpos, (float)ypos);
+
     if (gFirstMouse) {
         gLastX = (float)xpos;
         gLastY = (float)ypos;
@@ -476,105 +1154,1404 @@ static void mouse_callback(GLFWwindow*, double xpos, double ypos)
     front.y = sin(glm::radians(gPitch));
     front.z = sin(glm::radians(gYaw)) * cos(glm::radians(gPitch));
     gCamFront = glm::normalize(front);
+    gSceneDirty = true;
 }
 
 static void scroll_callback(GLFWwindow*, double, double yoffset)
 {
+    if (gInputMode == INPUT_REPLAY && !gReplayDispatching) return;
+    if (gInputMode == INPUT_RECORD) recordInputEvent(INPUT_EV_SCROLL, 0, 0, 0.0f, (float)yoffset);
+
     gFov -= (float)yoffset;
     if (gFov < 20.0f) gFov = 20.0f;
     if (gFov > 80.0f) gFov = 80.0f;
+    gSceneDirty = true;
 }
 
 //----------------------------------------------------------
-//  GRID
+//  INPUT RECORDING / REPLAY
 //----------------------------------------------------------
-static std::vector<float> buildGridFloor(
-    int halfSize, float cellSize, float y,
-    float r, float g, float b
-) {
-    std::vector<float> v;
-    v.reserve((2 * halfSize) * (2 * halfSize) * 6 * 11);
-
-    const float nx = 0.0f, ny = 1.0f, nz = 0.0f;
-    const float tile = 0.25f;
-
-    auto pushVertex = [&](float x, float yy, float z, float u, float vv) {
-        v.push_back(x);  v.push_back(yy); v.push_back(z);
-        v.push_back(nx); v.push_back(ny); v.push_back(nz);
-        v.push_back(r);  v.push_back(g);  v.push_back(b);
-        v.push_back(u);  v.push_back(vv);
-        };
-
-    for (int iz = -halfSize; iz < halfSize; ++iz) {
-        for (int ix = -halfSize; ix < halfSize; ++ix) {
-            float x0 = ix * cellSize;
-            float x1 = (ix + 1) * cellSize;
-            float z0 = iz * cellSize;
-            float z1 = (iz + 1) * cellSize;
-
-            float u0 = (float)ix * tile;
-            float u1 = (float)(ix + 1) * tile;
-            float v0 = (float)iz * tile;
-            float v1 = (float)(iz + 1) * tile;
-
-            pushVertex(x0, y, z0, u0, v0);
-            pushVertex(x1, y, z0, u1, v0);
-            pushVertex(x1, y, z1, u1, v1);
-
-            pushVertex(x0, y, z0, u0, v0);
-            pushVertex(x1, y, z1, u1, v1);
-            pushVertex(x0, y, z1, u0, v1);
-        }
-    }
-    return v;
-}
+// File layout: InputRecordHeader, then InputRecordEvent[eventCount].
+// Keys polled by processInput are stored as a bitmask (one event per
+// change), mouse/scroll callbacks as individual events. Times are
+// seconds since the recording started; replay hands them out against a
+// simulated clock advancing by gReplayDeltaTime per frame.
+static const uint32_t kInputRecordMagic = 0x52495343; // "CSIR"
+static const uint32_t kInputRecordVersion = 4; // 2: REC_PARTICLES, 3: particleCount, 4: swordFieldCount
+
+// bit index = position in this table, append only
+static const int kRecordedKeys[] = {
+    GLFW_KEY_P, GLFW_KEY_O, GLFW_KEY_ESCAPE,
+    GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E,
+    GLFW_KEY_F1, GLFW_KEY_G, GLFW_KEY_B, GLFW_KEY_F2, GLFW_KEY_F3, GLFW_KEY_L,
+    GLFW_KEY_F4, GLFW_KEY_F5, GLFW_KEY_F6,
+};
+static const int kRecordedKeyCount = (int)(sizeof(kRecordedKeys) / sizeof(kRecordedKeys[0]));
+
+#pragma pack(push, 1)
+struct InputRecordHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t eventCount;
+    int32_t windowW, windowH;
+
+    // initial scene state
+    float camPos[3];
+    float yaw, pitch, fov;
+    float swordPos[3];
+    float swordYaw, swordScale;
+    float lightTime;
+    uint32_t flags;
+
+    // workload the recording ran with, replays refuse to run a different one
+    uint32_t particleCount;
+    uint32_t swordFieldCount;
+};
 
-//----------------------------------------------------------
-//  INPUT
-//----------------------------------------------------------
-static void processInput(GLFWwindow* window)
-{
-    static bool pWasDown = false;
-    bool pDown = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
-    if (pDown && !pWasDown) {
-        gCursorEnabled = !gCursorEnabled;
-        glfwSetInputMode(window, GLFW_CURSOR, gCursorEnabled ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
-        gFirstMouse = true; // prevent jump when enabling mouse look again
-        std::cout << (gCursorEnabled ? "Cursor ON (picking)\n" : "Cursor OFF (camera look)\n");
-    }
-    pWasDown = pDown;
+struct InputRecordEvent {
+    float time;
+    uint8_t type;
+    uint8_t button;
+    uint8_t action;
+    uint8_t pad;
+    uint32_t a; // key mask, or float bits of x / scroll
+    uint32_t b; // float bits of y
+};
+#pragma pack(pop)
+
+enum InputRecordFlags : uint32_t {
+    REC_OBJECT_MODE = 1u << 0,
+    REC_WIREFRAME = 1u << 1,
+    REC_SHOW_GRID = 1u << 2,
+    REC_USE_BLINN = 1u << 3,
+    REC_DYNAMIC_RES = 1u << 4,
+    REC_LIGHT_PAUSED = 1u << 5,
+    REC_SWORD_SELECTED = 1u << 6,
+    REC_PARTICLES = 1u << 7,
+};
 
-    static bool oWasDown = false;
-    bool oDown = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
-    if (oDown && !oWasDown) {
-        gObjectMode = !gObjectMode;
-        std::cout << (gObjectMode ? "MODE: OBJECT | Press Q/E to rotate \n" : "MODE: CAMERA\n");
-    }
-    oWasDown = oDown;
+static std::string gRecordPath;
+static double gRecordStart = 0.0;
+static uint32_t gRecordKeyMask = 0;
+static InputRecordHeader gRecordHeader;
+static std::vector<InputRecordEvent> gRecordEvents;
 
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
+static std::vector<InputRecordEvent> gReplayEvents;
+static size_t gReplayNext = 0;
+static double gReplayTime = 0.0;
+static uint32_t gReplayKeyMask = 0;
 
-    float camSpeed = 8.0f * gDeltaTime;
-    glm::vec3 right = glm::normalize(glm::cross(gCamFront, gCamUp));
+static uint32_t floatBits(float f) { uint32_t u; std::memcpy(&u, &f, 4); return u; }
+static float bitsFloat(uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+
+static bool keyDown(GLFWwindow* window, int key)
+{
+    if (gInputMode != INPUT_REPLAY)
+        return glfwGetKey(window, key) == GLFW_PRESS;
+
+    for (int i = 0; i < kRecordedKeyCount; ++i)
+        if (kRecordedKeys[i] == key) return (gReplayKeyMask >> i) & 1u;
+    return false;
+}
+
+static void recordInputEvent(uint8_t type, uint8_t button, uint8_t action, float x, float y)
+{
+    InputRecordEvent e{};
+    e.time = (float)(glfwGetTime() - gRecordStart);
+    e.type = type;
+    e.button = button;
+    e.action = action;
+    e.a = floatBits(x);
+    e.b = floatBits(y);
+    gRecordEvents.push_back(e);
+}
+
+// called once per frame before processInput
+static void recordKeyState(GLFWwindow* window)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < kRecordedKeyCount; ++i)
+        if (glfwGetKey(window, kRecordedKeys[i]) == GLFW_PRESS) mask |= 1u << i;
+    if (mask == gRecordKeyMask) return;
+
+    recordInputEvent(INPUT_EV_KEYS, 0, 0, 0.0f, 0.0f);
+    gRecordEvents.back().a = mask;
+    gRecordKeyMask = mask;
+}
+
+static void captureInitialState(InputRecordHeader& h, GLFWwindow* window)
+{
+    h.magic = kInputRecordMagic;
+    h.version = kInputRecordVersion;
+    glfwGetWindowSize(window, &h.windowW, &h.windowH);
+
+    h.camPos[0] = gCamPos.x; h.camPos[1] = gCamPos.y; h.camPos[2] = gCamPos.z;
+    h.yaw = gYaw; h.pitch = gPitch; h.fov = gFov;
+    h.swordPos[0] = gSwordPos.x; h.swordPos[1] = gSwordPos.y; h.swordPos[2] = gSwordPos.z;
+    h.swordYaw = gSwordYaw; h.swordScale = gSwordScale;
+    h.lightTime = gLightTime;
+
+    h.flags = 0;
+    if (gObjectMode) h.flags |= REC_OBJECT_MODE;
+    if (gWireframe) h.flags |= REC_WIREFRAME;
+    if (gShowGrid) h.flags |= REC_SHOW_GRID;
+    if (gUseBlinn) h.flags |= REC_USE_BLINN;
+    if (gDynamicRes) h.flags |= REC_DYNAMIC_RES;
+    if (gLightPaused) h.flags |= REC_LIGHT_PAUSED;
+    if (gSwordSelected) h.flags |= REC_SWORD_SELECTED;
+    if (gParticlesEnabled && gParticleCount > 0) h.flags |= REC_PARTICLES;
+
+    h.particleCount = (uint32_t)gParticleCount;
+    h.swordFieldCount = (uint32_t)gSwordFieldCount;
+}
+
+static void applyInitialState(GLFWwindow* window)
+{
+    const InputRecordHeader& h = gRecordHeader;
+    glfwSetWindowSize(window, h.windowW, h.windowH);
+
+    gCamPos = glm::vec3(h.camPos[0], h.camPos[1], h.camPos[2]);
+    gYaw = h.yaw; gPitch = h.pitch; gFov = h.fov;
+    glm::vec3 front;
+    front.x = cos(glm::radians(gYaw)) * cos(glm::radians(gPitch));
+    front.y = sin(glm::radians(gPitch));
+    front.z = sin(glm::radians(gYaw)) * cos(glm::radians(gPitch));
+    gCamFront = glm::normalize(front);
+
+    gSwordPos = glm::vec3(h.swordPos[0], h.swordPos[1], h.swordPos[2]);
+    gSwordYaw = h.swordYaw; gSwordScale = h.swordScale;
+    gLightTime = h.lightTime;
+
+    gObjectMode = (h.flags & REC_OBJECT_MODE) != 0;
+    gWireframe = (h.flags & REC_WIREFRAME) != 0;
+    gShowGrid = (h.flags & REC_SHOW_GRID) != 0;
+    gUseBlinn = (h.flags & REC_USE_BLINN) != 0;
+    gDynamicRes = (h.flags & REC_DYNAMIC_RES) != 0;
+    gLightPaused = (h.flags & REC_LIGHT_PAUSED) != 0;
+    gSwordSelected = (h.flags & REC_SWORD_SELECTED) != 0;
+    gParticlesEnabled = (h.flags & REC_PARTICLES) != 0;
+    glPolygonMode(GL_FRONT_AND_BACK, gWireframe ? GL_LINE : GL_FILL);
+
+    gFirstMouse = true;
+    gRenderOnDemand = false; // replay must produce every frame
+}
+
+static bool startInputRecording(GLFWwindow* window, const char* path)
+{
+    captureInitialState(gRecordHeader, window);
+    gRecordPath = path;
+    gRecordEvents.clear();
+    gRecordKeyMask = ~0u; // forces the first frame's key state to be written
+    gRecordStart = glfwGetTime();
+    gInputMode = INPUT_RECORD;
+    std::cout << "Recording input to " << gRecordPath << "\n";
+    return true;
+}
+
+static bool finishInputRecording()
+{
+    if (gInputMode != INPUT_RECORD) return false;
+
+    recordInputEvent(INPUT_EV_END, 0, 0, 0.0f, 0.0f);
+    gRecordHeader.eventCount = (uint32_t)gRecordEvents.size();
+
+    std::ofstream out(gRecordPath.c_str(), std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write input recording: " << gRecordPath << "\n";
+        return false;
+    }
+    out.write((const char*)&gRecordHeader, sizeof(gRecordHeader));
+    out.write((const char*)gRecordEvents.data(), gRecordEvents.size() * sizeof(InputRecordEvent));
+    std::cout << "Input recording saved (" << gRecordEvents.size() << " events)\n";
+    return true;
+}
+
+static bool loadInputReplay(const char* path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open input recording: " << path << "\n";
+        return false;
+    }
+
+    InputRecordHeader h{};
+    in.read((char*)&h, sizeof(h));
+    if (!in || h.magic != kInputRecordMagic || h.version != kInputRecordVersion) {
+        std::cerr << "Not a valid input recording: " << path << "\n";
+        return false;
+    }
+
+    gReplayEvents.resize(h.eventCount);
+    in.read((char*)gReplayEvents.data(), h.eventCount * sizeof(InputRecordEvent));
+    if (!in) {
+        std::cerr << "Input recording truncated: " << path << "\n";
+        return false;
+    }
+
+    gRecordHeader = h;
+    gReplayNext = 0;
+    gReplayTime = 0.0;
+    gReplayKeyMask = 0;
+    gInputMode = INPUT_REPLAY;
+    return true;
+}
+
+// Feeds every event due at the current simulated time back through the
+// normal callbacks. Returns false once the recording has ended.
+static bool advanceInputReplay(GLFWwindow* window)
+{
+    gReplayTime += gReplayDeltaTime;
+    gReplayDispatching = true;
+
+    bool running = true;
+    while (gReplayNext < gReplayEvents.size() && gReplayEvents[gReplayNext].time <= gReplayTime) {
+        const InputRecordEvent& e = gReplayEvents[gReplayNext++];
+        switch (e.type) {
+        case INPUT_EV_KEYS:   gReplayKeyMask = e.a; break;
+        case INPUT_EV_CURSOR: mouse_callback(window, bitsFloat(e.a), bitsFloat(e.b)); break;
+        case INPUT_EV_SCROLL: scroll_callback(window, 0.0, bitsFloat(e.b)); break;
+        case INPUT_EV_BUTTON: mouse_button_callback(window, e.button, e.action, 0); break;
+        case INPUT_EV_END:    running = false; break;
+        default: break;
+        }
+    }
+
+    gReplayDispatching = false;
+    return running && gReplayNext < gReplayEvents.size();
+}
+
+//----------------------------------------------------------
+//  FRAME TIME STATISTICS
+//----------------------------------------------------------
+struct FrameStats {
+    int frames = 0;
+    float meanMs = 0.0f;
+    float p50Ms = 0.0f;
+    float p95Ms = 0.0f;
+    float p99Ms = 0.0f;
+    float maxMs = 0.0f;
+};
+
+static FrameStats computeFrameStats(std::vector<float> ms)
+{
+    FrameStats s;
+    if (ms.empty()) return s;
+
+    std::sort(ms.begin(), ms.end());
+    double sum = 0.0;
+    for (float v : ms) sum += v;
+
+    auto pct = [&](float p) { return ms[std::min(ms.size() - 1, (size_t)(p * (ms.size() - 1) + 0.5f))]; };
+    s.frames = (int)ms.size();
+    s.meanMs = (float)(sum / ms.size());
+    s.p50Ms = pct(0.50f);
+    s.p95Ms = pct(0.95f);
+    s.p99Ms = pct(0.99f);
+    s.maxMs = ms.back();
+    return s;
+}
+
+static bool writeFrameStats(const char* path, const std::vector<float>& frameMs)
+{
+    FrameStats s = computeFrameStats(frameMs);
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write frame stats: " << path << "\n";
+        return false;
+    }
+    out << "frames " << s.frames << "\n";
+    out << "mean_ms " << s.meanMs << "\n";
+    out << "p50_ms " << s.p50Ms << "\n";
+    out << "p95_ms " << s.p95Ms << "\n";
+    out << "p99_ms " << s.p99Ms << "\n";
+    out << "max_ms " << s.maxMs << "\n";
+
+    std::cout << "Frame stats: " << s.frames << " frames, mean " << s.meanMs
+        << " ms, p95 " << s.p95Ms << " ms, p99 " << s.p99Ms << " ms\n";
+    return true;
+}
+
+static bool readFrameStats(const char* path, std::map<std::string, float>& out)
+{
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open frame stats: " << path << "\n";
+        return false;
+    }
+    std::string key;
+    float value;
+    while (in >> key >> value) out[key] = value;
+    return !out.empty();
+}
+
+// Returns the process exit code: 0 = within threshold, 1 = regression, 2 = bad input.
+static int compareFrameStats(const char* baselinePath, const char* currentPath, float threshold)
+{
+    std::map<std::string, float> base, cur;
+    if (!readFrameStats(baselinePath, base) || !readFrameStats(currentPath, cur)) return 2;
+
+    const char* keys[] = { "mean_ms", "p50_ms", "p95_ms", "p99_ms" };
+    bool regressed = false;
+
+    for (const char* k : keys) {
+        if (!base.count(k) || !cur.count(k)) continue;
+        float b = base[k], c = cur[k];
+        float change = (b > 0.0f) ? (c - b) / b : 0.0f;
+        bool bad = change > threshold;
+        regressed = regressed || bad;
+
+        std::cout << k << ": " << b << " -> " << c << " ms ("
+            << (change >= 0.0f ? "+" : "") << change * 100.0f << "%)"
+            << (bad ? "  REGRESSION" : "") << "\n";
+    }
+
+    std::cout << (regressed ? "FAIL" : "PASS") << " (threshold " << threshold * 100.0f << "%)\n";
+    return regressed ? 1 : 0;
+}
+
+// N frames with the compiled variants, then N frames with the uber
+// shader, light paused so both phases draw the same scene.
+// Timer results lag a few frames, so the first kGpuTimerRing results
+// after each switch still belong to the previous phase and are dropped.
+struct ShaderBenchmark {
+    int framesPerPhase = 0;
+    int phase = 0;          // 0 = variants, 1 = uber, 2 = done
+    int resultsInPhase = 0;
+    std::vector<float> ms[2];
+};
+
+static void startShaderBenchmark(ShaderBenchmark& b, int framesPerPhase)
+{
+    b.framesPerPhase = framesPerPhase;
+    b.phase = 0;
+    b.resultsInPhase = 0;
+    gUseUberShader = false;
+    gLightPaused = true;
+    std::cout << "Shader benchmark: " << framesPerPhase << " frames per variant\n";
+}
+
+// returns false once both phases are measured and the report is printed
+static bool advanceShaderBenchmark(ShaderBenchmark& b, bool hasResult, float gpuMs)
+{
+    if (b.phase >= 2) return false;
+    if (!hasResult) return true;
+
+    if (++b.resultsInPhase > kGpuTimerRing) b.ms[b.phase].push_back(gpuMs);
+    if ((int)b.ms[b.phase].size() < b.framesPerPhase) return true;
+
+    ++b.phase;
+    b.resultsInPhase = 0;
+    gUseUberShader = (b.phase == 1);
+    if (b.phase < 2) return true;
+
+    FrameStats variants = computeFrameStats(b.ms[0]);
+    FrameStats uber = computeFrameStats(b.ms[1]);
+    std::cout << "GPU ms        mean     p50     p95\n";
+    std::cout << "variants  " << variants.meanMs << "  " << variants.p50Ms << "  " << variants.p95Ms << "\n";
+    std::cout << "uber      " << uber.meanMs << "  " << uber.p50Ms << "  " << uber.p95Ms << "\n";
+    if (uber.meanMs > 0.0f)
+        std::cout << "variants take " << 100.0f * variants.meanMs / uber.meanMs << "% of the uber shader's time\n";
+    gUseUberShader = false;
+    return false;
+}
+
+//----------------------------------------------------------
+//  PARTICLES (transform feedback)
+//----------------------------------------------------------
+// Sparks, embers and dust around the sword, simulated entirely on the GPU.
+// Particle state lives in two VBOs. Each frame a vertex-only program reads
+// one and writes the other through transform feedback (rasterizer
+// discarded), then the fresh buffer is drawn as instanced additive
+// billboards. The CPU only fills the buffers once at init; after that it
+// uploads a handful of emitter uniforms per frame. Particles respawn in
+// the update shader when their lifetime runs out.
+static const int kMaxParticleEmitters = 8; // MAX_EMITTERS in the particle shaders
+
+struct ParticleState {
+    glm::vec4 posAge;   // xyz position, w age (negative = not born yet)
+    glm::vec4 velLife;  // xyz velocity, w lifetime
+    glm::vec2 seedKind; // x random seed, y emitter index
+};
+
+struct ParticleEmitter {
+    glm::mat4 (*anchor)() = nullptr; // scene object the emitter follows
+    glm::vec3 offset = glm::vec3(0.0f); // in the anchor's local space
+    float share = 1.0f;                 // fraction of the particle budget
+    float radius = 0.1f;                // spawn sphere, world units
+    glm::vec3 velocity = glm::vec3(0.0f);
+    float spread = 0.0f;
+    float lifeMin = 1.0f, lifeMax = 1.0f;
+    float gravity = 0.0f; // +y acceleration, negative falls
+    float drag = 0.0f;
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+    float size = 0.05f;
+};
+
+struct ParticleSystem {
+    GLuint vbo[2] = { 0, 0 };
+    GLuint updateVAO[2] = { 0, 0 }; // reads vbo[i] per vertex
+    GLuint renderVAO[2] = { 0, 0 }; // reads vbo[i] per instance
+    GLuint updateProgram = 0, renderProgram = 0;
+    int count = 0;
+    int current = 0; // vbo holding the latest state
+    float time = 0.0f;
+    std::vector<ParticleEmitter> emitters;
+
+    GLint uDeltaTime = -1, uTime = -1;
+    GLint uEmitterPos = -1, uEmitterVel = -1, uEmitterShape = -1, uEmitterDrag = -1;
+    GLint uView = -1, uProjection = -1, uEmitterColor = -1, uEmitterSize = -1;
+};
+
+// opt-in (--particles): they animate every frame, so while they run
+// render on demand never goes idle
+static ParticleSystem gParticles;
+
+static GLuint createTransformFeedbackProgram(const char* vsPath, const char* const* varyings, int varyingCount)
+{
+    GLuint vs = compileShaderFromFile(GL_VERTEX_SHADER, vsPath);
+
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, vs);
+    glTransformFeedbackVaryings(prog, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(prog);
+
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetProgramInfoLog(prog, 1024, nullptr, log);
+        std::cerr << "Program link error (" << vsPath << "):\n" << log << "\n";
+    }
+
+    glDeleteShader(vs);
+    return prog;
+}
+
+// sparks and embers off the blade, dust kicked up around its footprint
+static std::vector<ParticleEmitter> defaultSwordEmitters()
+{
+    glm::vec3 center = 0.5f * (gSwordLocalMin + gSwordLocalMax);
+    float extent = std::max(0.2f, 0.5f * glm::length(gSwordLocalMax - gSwordLocalMin) * gSwordScale);
+
+    ParticleEmitter sparks;
+    sparks.anchor = swordModelMatrix;
+    sparks.offset = center;
+    sparks.share = 0.3f;
+    sparks.radius = 0.5f * extent;
+    sparks.velocity = glm::vec3(0.0f, 2.5f, 0.0f);
+    sparks.spread = 3.0f;
+    sparks.lifeMin = 0.4f; sparks.lifeMax = 1.0f;
+    sparks.gravity = -9.8f;
+    sparks.drag = 1.5f;
+    sparks.color = glm::vec3(1.0f, 0.65f, 0.25f);
+    sparks.intensity = 1.5f;
+    sparks.size = 0.02f;
+
+    ParticleEmitter embers;
+    embers.anchor = swordModelMatrix;
+    embers.offset = center;
+    embers.share = 0.3f;
+    embers.radius = extent;
+    embers.velocity = glm::vec3(0.0f, 0.6f, 0.0f);
+    embers.spread = 0.4f;
+    embers.lifeMin = 2.0f; embers.lifeMax = 4.0f;
+    embers.gravity = 0.3f; // buoyant
+    embers.drag = 0.5f;
+    embers.color = glm::vec3(1.0f, 0.3f, 0.05f);
+    embers.intensity = 0.8f;
+    embers.size = 0.04f;
+
+    ParticleEmitter dust;
+    dust.anchor = swordBakeToWorld; // floor level, follows the sword in XZ
+    dust.offset = glm::vec3(0.0f, 0.1f, 0.0f);
+    dust.share = 0.4f;
+    dust.radius = 2.0f * extent;
+    dust.velocity = glm::vec3(0.0f, 0.05f, 0.0f);
+    dust.spread = 0.15f;
+    dust.lifeMin = 3.0f; dust.lifeMax = 6.0f;
+    dust.drag = 0.2f;
+    dust.color = glm::vec3(0.6f, 0.55f, 0.5f);
+    dust.intensity = 0.05f;
+    dust.size = 0.06f;
+
+    return { sparks, embers, dust };
+}
+
+static void setParticleVertexFormat(GLuint divisor)
+{
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleState), (void*)offsetof(ParticleState, posAge));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleState), (void*)offsetof(ParticleState, velLife));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleState), (void*)offsetof(ParticleState, seedKind));
+    for (GLuint i = 0; i < 3; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, divisor);
+    }
+}
+
+static bool initParticleSystem(ParticleSystem& ps, int count, const std::vector<ParticleEmitter>& emitters)
+{
+    if (count <= 0 || emitters.empty()) return false;
+
+    ps.count = count;
+    ps.current = 0;
+    ps.time = 0.0f;
+    ps.emitters.assign(emitters.begin(), emitters.begin() + std::min((int)emitters.size(), kMaxParticleEmitters));
+
+    const char* varyings[] = { "tfPosAge", "tfVelLife", "tfSeedKind" };
+    ps.updateProgram = createTransformFeedbackProgram("shaders/particle_update.vert", varyings, 3);
+    ps.renderProgram = createProgram("shaders/particle.vert", "shaders/particle.frag");
+
+    ps.uDeltaTime = glGetUniformLocation(ps.updateProgram, "uDeltaTime");
+    ps.uTime = glGetUniformLocation(ps.updateProgram, "uTime");
+    ps.uEmitterPos = glGetUniformLocation(ps.updateProgram, "uEmitterPos");
+    ps.uEmitterVel = glGetUniformLocation(ps.updateProgram, "uEmitterVel");
+    ps.uEmitterShape = glGetUniformLocation(ps.updateProgram, "uEmitterShape");
+    ps.uEmitterDrag = glGetUniformLocation(ps.updateProgram, "uEmitterDrag");
+    ps.uView = glGetUniformLocation(ps.renderProgram, "view");
+    ps.uProjection = glGetUniformLocation(ps.renderProgram, "projection");
+    ps.uEmitterColor = glGetUniformLocation(ps.renderProgram, "uEmitterColor");
+    ps.uEmitterSize = glGetUniformLocation(ps.renderProgram, "uEmitterSize");
+
+    // spawn: split the budget between emitters, births staggered over one
+    // lifetime so there is no initial burst. Unborn particles have life 0,
+    // so the update shader respawns them properly as their age crosses 0.
+    float shareSum = 0.0f;
+    for (const auto& e : ps.emitters) shareSum += e.share;
+
+    std::vector<ParticleState> init((size_t)count);
+    uint32_t rng = 0x9e3779b9u;
+    auto next01 = [&rng]() {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        return (float)(rng >> 8) / 16777216.0f;
+    };
+
+    size_t first = 0;
+    for (size_t ei = 0; ei < ps.emitters.size(); ++ei) {
+        const ParticleEmitter& e = ps.emitters[ei];
+        size_t n = (ei + 1 == ps.emitters.size()) ? (size_t)count - first
+            : (size_t)((double)count * e.share / shareSum);
+        n = std::min(n, (size_t)count - first);
+
+        for (size_t i = first; i < first + n; ++i) {
+            init[i].posAge = glm::vec4(0.0f, -1000.0f, 0.0f, -next01() * e.lifeMax);
+            init[i].velLife = glm::vec4(0.0f);
+            init[i].seedKind = glm::vec2(next01(), (float)ei);
+        }
+        first += n;
+    }
+
+    glGenBuffers(2, ps.vbo);
+    glGenVertexArrays(2, ps.updateVAO);
+    glGenVertexArrays(2, ps.renderVAO);
+
+    for (int i = 0; i < 2; ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, ps.vbo[i]);
+        glBufferData(GL_ARRAY_BUFFER, init.size() * sizeof(ParticleState), i == 0 ? init.data() : nullptr, GL_DYNAMIC_COPY);
+
+        glBindVertexArray(ps.updateVAO[i]);
+        setParticleVertexFormat(0);
+
+        glBindVertexArray(ps.renderVAO[i]);
+        setParticleVertexFormat(1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::cout << "Particles: " << count << " (" << count * sizeof(ParticleState) * 2 / (1024 * 1024) << " MB)\n";
+    return true;
+}
+
+static void destroyParticleSystem(ParticleSystem& ps)
+{
+    if (ps.vbo[0]) glDeleteBuffers(2, ps.vbo);
+    if (ps.updateVAO[0]) glDeleteVertexArrays(2, ps.updateVAO);
+    if (ps.renderVAO[0]) glDeleteVertexArrays(2, ps.renderVAO);
+    if (ps.updateProgram) glDeleteProgram(ps.updateProgram);
+    if (ps.renderProgram) glDeleteProgram(ps.renderProgram);
+    ps = ParticleSystem();
+}
+
+static void updateParticles(ParticleSystem& ps, float dt)
+{
+    if (!ps.count) return;
+    ps.time += dt;
+
+    glm::vec3 pos[kMaxParticleEmitters];
+    glm::vec4 vel[kMaxParticleEmitters], shape[kMaxParticleEmitters];
+    float drag[kMaxParticleEmitters];
+    int n = (int)ps.emitters.size();
+    for (int i = 0; i < n; ++i) {
+        const ParticleEmitter& e = ps.emitters[i];
+        glm::mat4 anchor = e.anchor ? e.anchor() : glm::mat4(1.0f);
+        pos[i] = glm::vec3(anchor * glm::vec4(e.offset, 1.0f));
+        vel[i] = glm::vec4(e.velocity, e.spread);
+        shape[i] = glm::vec4(e.radius, e.lifeMin, e.lifeMax, e.gravity);
+        drag[i] = e.drag;
+    }
+
+    glUseProgram(ps.updateProgram);
+    glUniform1f(ps.uDeltaTime, dt);
+    glUniform1f(ps.uTime, ps.time);
+    glUniform3fv(ps.uEmitterPos, n, glm::value_ptr(pos[0]));
+    glUniform4fv(ps.uEmitterVel, n, glm::value_ptr(vel[0]));
+    glUniform4fv(ps.uEmitterShape, n, glm::value_ptr(shape[0]));
+    glUniform1fv(ps.uEmitterDrag, n, drag);
+
+    int dst = 1 - ps.current;
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(ps.updateVAO[ps.current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, ps.vbo[dst]);
+
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, ps.count);
+    glEndTransformFeedback();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    ps.current = dst;
+}
+
+// additive, depth-tested against the scene but never writing depth
+static void drawParticles(const ParticleSystem& ps, const glm::mat4& view, const glm::mat4& projection)
+{
+    if (!ps.count) return;
+
+    glm::vec4 color[kMaxParticleEmitters];
+    float size[kMaxParticleEmitters];
+    int n = (int)ps.emitters.size();
+    for (int i = 0; i < n; ++i) {
+        color[i] = glm::vec4(ps.emitters[i].color, ps.emitters[i].intensity);
+        size[i] = ps.emitters[i].size;
+    }
+
+    glUseProgram(ps.renderProgram);
+    glUniformMatrix4fv(ps.uView, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(ps.uProjection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform4fv(ps.uEmitterColor, n, glm::value_ptr(color[0]));
+    glUniform1fv(ps.uEmitterSize, n, size);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    glBindVertexArray(ps.renderVAO[ps.current]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, ps.count);
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+// --bench-particles: update + draw N particles into an offscreen target
+// from the default camera, GPU time per frame from the timer queries.
+// Uses a hidden window, so it runs on a headless box with Mesa (llvmpipe)
+// as long as there is a display to connect to, e.g. Xvfb.
+static int runParticleBenchmark(int count, int frames, const char* statsPath)
+{
+    loadSwordMeshes("assets/models/myModel/sword.obj"); // emitter placement only
+    if (!initParticleSystem(gParticles, count, defaultSwordEmitters())) return -1;
+
+    const int width = 1280, height = 720;
+    SceneTarget target;
+    resizeSceneTarget(target, width, height);
+    GpuFrameTimer timer;
+    initGpuFrameTimer(timer);
+
+    glm::mat4 view = glm::lookAt(gCamPos, gCamPos + gCamFront, gCamUp);
+    glm::mat4 projection = glm::perspective(glm::radians(gFov), (float)width / (float)height, 0.1f, 500.0f);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+
+    // simulate ahead in coarse steps until every particle has been born
+    for (int i = 0; i < 64; ++i) updateParticles(gParticles, 0.1f);
+    glFinish();
+
+    // the timer ring skips frames while full, so gpuMs is a sample of the run
+    std::vector<float> gpuMs;
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < frames; ++frame) {
+        float ms;
+        if (pollGpuFrameTimer(timer, ms)) gpuMs.push_back(ms);
+
+        beginGpuFrameTimer(timer);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        updateParticles(gParticles, gReplayDeltaTime);
+        drawParticles(gParticles, view, projection);
+        endGpuFrameTimer(timer);
+    }
+    glFinish();
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    float ms;
+    while (pollGpuFrameTimer(timer, ms)) gpuMs.push_back(ms);
+
+    FrameStats stats = computeFrameStats(gpuMs);
+    std::cout << "Particle benchmark: " << count << " particles, " << frames << " frames\n";
+    std::cout << "GPU ms  mean " << stats.meanMs << "  p50 " << stats.p50Ms << "  p95 " << stats.p95Ms << "\n";
+    std::cout << "wall ms per frame " << wallMs / frames << "\n";
+
+    int exitCode = 0;
+    if (statsPath && !writeFrameStats(statsPath, gpuMs)) exitCode = 2;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteQueries(kGpuTimerRing, timer.queries);
+    destroySceneTarget(target);
+    destroyParticleSystem(gParticles);
+    return exitCode;
+}
+
+//----------------------------------------------------------
+//  GPU CULLING (compute + indirect draw)
+//----------------------------------------------------------
+// --sword-field <n> scatters n more swords around the scene. Their
+// transforms and bounding spheres are uploaded once. Each frame a compute
+// pass tests every instance against the view frustum and against a depth
+// pyramid (Hi-Z) built from the previous frame's depth, appends the
+// survivors to a compacted instance buffer and counts them straight into
+// DrawElementsIndirectCommand records, which glMultiDrawElementsIndirect
+// then consumes. Nothing is read back, so the CPU does the same handful
+// of calls per frame whether the field holds ten swords or a million.
+//
+// Compute and multi-draw-indirect are GL 4.3 and glad here only loads
+// 3.3, so those entry points come from glfwGetProcAddress. Asking for a
+// 3.3 core context still gets the newest core version from Mesa (llvmpipe
+// included, LIBGL_ALWAYS_SOFTWARE=1) and the desktop drivers. Without 4.3
+// the field is drawn unculled with one instanced draw per batch, which is
+// also what F6 switches to for comparison.
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+
+struct CullingGL {
+    void (APIENTRYP dispatchCompute)(GLuint x, GLuint y, GLuint z) = nullptr;
+    void (APIENTRYP memoryBarrier)(GLbitfield barriers) = nullptr;
+    void (APIENTRYP bindImageTexture)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format) = nullptr;
+    void (APIENTRYP multiDrawElementsIndirect)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride) = nullptr;
+};
+
+// std430 layout of Instance in cull_instances.comp; the visible buffer
+// holds the same records and feeds attributes 6 and 7 per instance
+struct FieldInstance {
+    glm::vec4 posScale; // xyz position, w uniform scale
+    glm::vec4 rotation; // cos(yaw), sin(yaw), unused, unused
+    glm::vec4 sphere;   // world bounding sphere: xyz centre, w radius
+};
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount; // written by the cull pass
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct SwordField {
+    int count = 0;
+    bool gpuCulling = false;   // compute path available
+    CullingGL gl;
+
+    GLuint instanceBuffer = 0; // every instance, static
+    GLuint visibleBuffer = 0;  // compacted survivors, rewritten each frame
+    GLuint commandBuffer = 0;  // one DrawElementsIndirectCommand per sword batch
+    GLuint commandTemplate = 0; // same commands with instanceCount 0, copied over each frame
+    GLuint culledVAO = 0;      // sword mesh + visibleBuffer per instance
+    GLuint allVAO = 0;         // sword mesh + instanceBuffer per instance
+    GLuint cullProgram = 0;
+    GLint uInstanceCount = -1, uCommandCount = -1, uFrustum = -1;
+    GLint uUseHiZ = -1, uHiZViewProj = -1, uHiZUVScale = -1;
+
+    // depth pyramid of the previous frame
+    GLuint hizTex = 0;
+    GLuint hizCopyProgram = 0, hizReduceProgram = 0;
+    int hizWidth = 0, hizHeight = 0, hizLevels = 0;
+    bool hizValid = false;
+    glm::mat4 hizViewProj = glm::mat4(1.0f);
+    glm::vec2 hizUVScale = glm::vec2(1.0f);
+};
+
+static SwordField gSwordField;
+static bool gGpuCullingEnabled = true;
+
+template <typename Fn>
+static bool loadGLEntry(Fn& fn, const char* name)
+{
+    fn = reinterpret_cast<Fn>(glfwGetProcAddress(name));
+    return fn != nullptr;
+}
+
+static bool loadCullingEntryPoints(CullingGL& gl)
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major * 10 + minor < 43) return false;
+
+    bool ok = loadGLEntry(gl.dispatchCompute, "glDispatchCompute");
+    ok = loadGLEntry(gl.memoryBarrier, "glMemoryBarrier") && ok;
+    ok = loadGLEntry(gl.bindImageTexture, "glBindImageTexture") && ok;
+    ok = loadGLEntry(gl.multiDrawElementsIndirect, "glMultiDrawElementsIndirect") && ok;
+    return ok;
+}
+
+static GLuint createComputeProgram(const char* csPath, const std::string& defines = std::string())
+{
+    GLuint cs = compileShaderFromFile(GL_COMPUTE_SHADER, csPath, defines);
+
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, cs);
+    glLinkProgram(prog);
+
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetProgramInfoLog(prog, 1024, nullptr, log);
+        std::cerr << "Program link error (" << csPath << "):\n" << log << "\n";
+    }
+
+    glDeleteShader(cs);
+    return prog;
+}
+
+// Rings of 3-unit cells around the origin, nearest first, skipping the
+// centre cell where the scene's own sword stands. Each sword is jittered
+// in its cell with a random yaw and scale.
+static std::vector<FieldInstance> buildSwordFieldInstances(int count)
+{
+    const float spacing = 3.0f;
+    int side = 1;
+    while (side * side - 1 < count) side += 2;
+
+    std::vector<glm::ivec2> cells;
+    for (int z = -side / 2; z <= side / 2; ++z)
+        for (int x = -side / 2; x <= side / 2; ++x)
+            if (x != 0 || z != 0) cells.push_back(glm::ivec2(x, z));
+    std::stable_sort(cells.begin(), cells.end(), [](const glm::ivec2& a, const glm::ivec2& b) {
+        return a.x * a.x + a.y * a.y < b.x * b.x + b.y * b.y;
+    });
+
+    uint32_t rng = 0x2545f491u;
+    auto next01 = [&rng]() {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        return (float)(rng >> 8) / 16777216.0f;
+    };
+
+    glm::vec3 localCenter = 0.5f * (gSwordLocalMin + gSwordLocalMax);
+    float localRadius = 0.5f * glm::length(gSwordLocalMax - gSwordLocalMin);
+
+    std::vector<FieldInstance> out((size_t)count);
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 pos((float)cells[i].x * spacing + (next01() - 0.5f) * 1.6f, gSwordPos.y,
+            (float)cells[i].y * spacing + (next01() - 0.5f) * 1.6f);
+        float yaw = next01() * 360.0f;
+        float scale = 0.7f + 0.6f * next01();
+
+        glm::mat4 model = composeModelMatrix(pos, yaw, scale);
+        out[i].posScale = glm::vec4(pos, scale);
+        out[i].rotation = glm::vec4(std::cos(glm::radians(yaw)), std::sin(glm::radians(yaw)), 0.0f, 0.0f);
+        out[i].sphere = glm::vec4(glm::vec3(model * glm::vec4(localCenter, 1.0f)), localRadius * scale);
+    }
+    return out;
+}
+
+// the sword's own streams plus the per-instance transform from instances
+static GLuint createSwordFieldVAO(GLuint instances)
+{
+    GLuint vao = 0;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, gSwordGL.VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, pos));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, normal));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, uv));
+    glEnableVertexAttribArray(3);
+
+    glBindBuffer(GL_ARRAY_BUFFER, gSwordGL.layerVBO);
+    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+    glEnableVertexAttribArray(5);
+
+    if (gSwordGL.aoVBO) {
+        glBindBuffer(GL_ARRAY_BUFFER, gSwordGL.aoVBO);
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+        glEnableVertexAttribArray(4);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instances);
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(FieldInstance), (void*)offsetof(FieldInstance, posScale));
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(FieldInstance), (void*)offsetof(FieldInstance, rotation));
+    for (GLuint i = 6; i < 8; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gSwordGL.EBO);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vao;
+}
+
+// after uploadSwordToGPU and the AO bake, which both add sword streams
+static bool initSwordField(SwordField& f, int count)
+{
+    if (count <= 0 || !gSwordGL.VAO) return false;
+
+    f.count = count;
+    std::vector<FieldInstance> instances = buildSwordFieldInstances(count);
+
+    glGenBuffers(1, &f.instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, f.instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(FieldInstance), instances.data(), GL_STATIC_DRAW);
+    f.allVAO = createSwordFieldVAO(f.instanceBuffer);
+
+    f.gpuCulling = loadCullingEntryPoints(f.gl);
+    if (!f.gpuCulling) {
+        std::cout << "Sword field: " << count << " swords, GL 4.3 not available, drawing them unculled\n";
+        return true;
+    }
+
+    glGenBuffers(1, &f.visibleBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, f.visibleBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(FieldInstance), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    f.culledVAO = createSwordFieldVAO(f.visibleBuffer);
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    for (const auto& b : gSwordGL.batches) {
+        DrawElementsIndirectCommand c;
+        c.count = (GLuint)b.indexCount;
+        c.instanceCount = 0;
+        c.firstIndex = (GLuint)(b.indexOffset / sizeof(unsigned int));
+        c.baseVertex = 0;
+        c.baseInstance = 0;
+        commands.push_back(c);
+    }
+    GLsizeiptr commandBytes = (GLsizeiptr)(commands.size() * sizeof(DrawElementsIndirectCommand));
+
+    glGenBuffers(1, &f.commandTemplate);
+    glBindBuffer(GL_COPY_READ_BUFFER, f.commandTemplate);
+    glBufferData(GL_COPY_READ_BUFFER, commandBytes, commands.data(), GL_STATIC_COPY);
+    glGenBuffers(1, &f.commandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, f.commandBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, commandBytes, commands.data(), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    f.cullProgram = createComputeProgram("shaders/cull_instances.comp");
+    f.uInstanceCount = glGetUniformLocation(f.cullProgram, "uInstanceCount");
+    f.uCommandCount = glGetUniformLocation(f.cullProgram, "uCommandCount");
+    f.uFrustum = glGetUniformLocation(f.cullProgram, "uFrustum");
+    f.uUseHiZ = glGetUniformLocation(f.cullProgram, "uUseHiZ");
+    f.uHiZViewProj = glGetUniformLocation(f.cullProgram, "uHiZViewProj");
+    f.uHiZUVScale = glGetUniformLocation(f.cullProgram, "uHiZUVScale");
+
+    f.hizCopyProgram = createComputeProgram("shaders/hiz_build.comp", "#define COPY_DEPTH\n");
+    f.hizReduceProgram = createComputeProgram("shaders/hiz_build.comp");
+
+    std::cout << "Sword field: " << count << " swords, GPU culled ("
+        << commands.size() << " indirect commands)\n";
+    return true;
+}
+
+static void destroySwordField(SwordField& f)
+{
+    GLuint buffers[] = { f.instanceBuffer, f.visibleBuffer, f.commandBuffer, f.commandTemplate };
+    for (GLuint b : buffers) if (b) glDeleteBuffers(1, &b);
+    if (f.culledVAO) glDeleteVertexArrays(1, &f.culledVAO);
+    if (f.allVAO) glDeleteVertexArrays(1, &f.allVAO);
+    if (f.cullProgram) glDeleteProgram(f.cullProgram);
+    if (f.hizCopyProgram) glDeleteProgram(f.hizCopyProgram);
+    if (f.hizReduceProgram) glDeleteProgram(f.hizReduceProgram);
+    if (f.hizTex) glDeleteTextures(1, &f.hizTex);
+    f = SwordField();
+}
+
+// culling runs and needs last frame's depth in a texture
+static bool swordFieldUsesHiZ(const SwordField& f)
+{
+    return f.count > 0 && f.gpuCulling && gGpuCullingEnabled;
+}
+
+// planes as (inward normal, distance), normalized, from clip = viewProj * world
+static void frustumPlanes(const glm::mat4& m, glm::vec4 planes[6])
+{
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; ++i) row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    planes[0] = row[3] + row[0]; // left
+    planes[1] = row[3] - row[0]; // right
+    planes[2] = row[3] + row[1]; // bottom
+    planes[3] = row[3] - row[1]; // top
+    planes[4] = row[3] + row[2]; // near
+    planes[5] = row[3] - row[2]; // far
+    for (int i = 0; i < 6; ++i) planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+static void cullSwordField(SwordField& f, const glm::mat4& viewProj)
+{
+    if (!swordFieldUsesHiZ(f)) return;
+
+    GLsizeiptr commandBytes = (GLsizeiptr)(gSwordGL.batches.size() * sizeof(DrawElementsIndirectCommand));
+    glBindBuffer(GL_COPY_READ_BUFFER, f.commandTemplate);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, f.commandBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, commandBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glm::vec4 planes[6];
+    frustumPlanes(viewProj, planes);
+
+    glUseProgram(f.cullProgram);
+    glUniform1i(f.uInstanceCount, f.count);
+    glUniform1i(f.uCommandCount, (GLint)gSwordGL.batches.size());
+    glUniform4fv(f.uFrustum, 6, glm::value_ptr(planes[0]));
+    glUniform1i(f.uUseHiZ, f.hizValid ? 1 : 0);
+    glUniformMatrix4fv(f.uHiZViewProj, 1, GL_FALSE, glm::value_ptr(f.hizViewProj));
+    glUniform2fv(f.uHiZUVScale, 1, glm::value_ptr(f.hizUVScale));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, f.hizValid ? f.hizTex : 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, f.instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, f.visibleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, f.commandBuffer);
+
+    f.gl.dispatchCompute((GLuint)((f.count + 63) / 64), 1, 1);
+    RENDER_STATS_DISPATCH();
+    f.gl.memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    for (GLuint i = 0; i < 3; ++i) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// one indirect command per sword batch; batches differ in the bound
+// texture array, so each is its own multi-draw
+static void drawSwordField(const SwordField& f, unsigned features, const SceneFrameUniforms& frame)
+{
+    if (!f.count) return;
+    bool culled = swordFieldUsesHiZ(f);
+
+    glVertexAttrib3f(2, 1.0f, 1.0f, 1.0f);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(culled ? f.culledVAO : f.allVAO);
+    if (culled) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, f.commandBuffer);
+
+    const glm::mat3 identity(1.0f);
+    for (size_t i = 0; i < gSwordGL.batches.size(); ++i) {
+        const DrawBatch& b = gSwordGL.batches[i];
+        unsigned fb = features | SHADER_INSTANCED;
+        if (b.array >= 0) fb |= SHADER_USE_TEXTURE;
+
+        SceneProgram& p = useSceneProgram(fb, frame);
+        glUniformMatrix3fv(p.normalMatrix, 1, GL_FALSE, glm::value_ptr(identity));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, b.array >= 0 ? gMaterialArrays[b.array].tex : 0);
+
+        if (culled) {
+            f.gl.multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (const void*)(i * sizeof(DrawElementsIndirectCommand)), 1, 0);
+            RENDER_STATS_INDIRECT_DRAW();
+        }
+        else {
+            glDrawElementsInstanced(GL_TRIANGLES, b.indexCount, GL_UNSIGNED_INT, (void*)b.indexOffset, f.count);
+        }
+    }
+
+    if (culled) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// full mip chain of R32F, level 0 the size of the scene target
+static void resizeHiZ(SwordField& f, int w, int h)
+{
+    if (f.hizTex && f.hizWidth == w && f.hizHeight == h) return;
+    if (f.hizTex) glDeleteTextures(1, &f.hizTex);
+
+    f.hizWidth = w;
+    f.hizHeight = h;
+    f.hizLevels = 1;
+    while ((std::max(w, h) >> f.hizLevels) > 0) ++f.hizLevels;
+    f.hizValid = false;
+
+    glGenTextures(1, &f.hizTex);
+    glBindTexture(GL_TEXTURE_2D, f.hizTex);
+    for (int level = 0; level < f.hizLevels; ++level)
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(1, w >> level), std::max(1, h >> level), 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, f.hizLevels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// after the scene pass: next frame's cull tests against this depth
+static void buildHiZ(SwordField& f, const SceneTarget& t, int sceneW, int sceneH, const glm::mat4& viewProj)
+{
+    if (!swordFieldUsesHiZ(f) || !t.depthTex) return;
+    resizeHiZ(f, t.width, t.height);
+
+    glUseProgram(f.hizCopyProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, t.depthTex);
+    f.gl.bindImageTexture(1, f.hizTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    f.gl.dispatchCompute((GLuint)((f.hizWidth + 7) / 8), (GLuint)((f.hizHeight + 7) / 8), 1);
+    RENDER_STATS_DISPATCH();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glUseProgram(f.hizReduceProgram);
+    for (int level = 1; level < f.hizLevels; ++level) {
+        int w = std::max(1, f.hizWidth >> level), h = std::max(1, f.hizHeight >> level);
+        f.gl.memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        f.gl.bindImageTexture(0, f.hizTex, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        f.gl.bindImageTexture(1, f.hizTex, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        f.gl.dispatchCompute((GLuint)((w + 7) / 8), (GLuint)((h + 7) / 8), 1);
+        RENDER_STATS_DISPATCH();
+    }
+    f.gl.memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    f.hizViewProj = viewProj;
+    f.hizUVScale = glm::vec2((float)sceneW / (float)t.width, (float)sceneH / (float)t.height);
+    f.hizValid = true;
+}
+
+//----------------------------------------------------------
+//  SOFTWARE BACKEND
+//----------------------------------------------------------
+// Renders the scene through SoftRenderer without a window or a GL
+// context, for machines with no usable GPU. Same assets, baked AO,
+// camera, light and shading as the GL path; the last frame is written
+// out as a PPM and per-frame CPU times go to the console (or --stats).
+static bool loadSoftTexture(const char* path, SoftTexture& tex)
+{
+    stbi_set_flip_vertically_on_load(true); // same orientation as buildMaterialArrays
+
+    int w, h, channels;
+    unsigned char* data = stbi_load(path, &w, &h, &channels, 0);
+    if (!data) {
+        std::cerr << "Failed to load texture: " << path << "\n";
+        return false;
+    }
+    softBuildTexture(tex, data, w, h, channels);
+    stbi_image_free(data);
+    return true;
+}
+
+static void loadSoftCubemap(const std::vector<std::string>& faces, SoftCubemap& cube)
+{
+    stbi_set_flip_vertically_on_load(false);
+
+    SkyFace images[6];
+    for (int i = 0; i < (int)faces.size() && i < 6; ++i) {
+        SkyFace& img = images[i];
+        unsigned char* data = stbi_load(faces[i].c_str(), &img.width, &img.height, &img.channels, 0);
+        if (!data) {
+            std::cerr << "Cubemap failed to load: " << faces[i] << "\n";
+            continue;
+        }
+        img.pixels = data;
+        softBuildCubemapFace(cube, i, data, img.width, img.height, img.channels);
+    }
+
+    computeSkyAmbient(images);
+    for (SkyFace& img : images)
+        if (img.pixels) stbi_image_free((void*)img.pixels);
+}
+
+static int runSoftwareRenderer(const char* outPath, int width, int height, int frames, const char* statsPath)
+{
+    if (!loadSwordMeshes("assets/models/myModel/sword.obj")) std::cerr << "Sword load failed.\n";
+    computeStaticAmbientOcclusion();
+
+    SoftTexture floorTex, swordTex, lightmap;
+    bool floorOK = loadSoftTexture("assets/textures/floor.jpg", floorTex);
+    bool swordOK = loadSoftTexture("assets/textures/sword.png", swordTex);
+
+    SoftCubemap sky;
+    loadSoftCubemap(skyboxFaces(), sky);
+
+    if (!gFloorLightmapAO.empty()) {
+        std::vector<unsigned char> bytes(gFloorLightmapAO.size());
+        for (size_t i = 0; i < gFloorLightmapAO.size(); ++i)
+            bytes[i] = (unsigned char)(glm::clamp(gFloorLightmapAO[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+        softBuildTexture(lightmap, bytes.data(), gLightmapSize, gLightmapSize, 1);
+    }
+
+    // sword: constant white vertex colour like glVertexAttrib3f(2, 1, 1, 1)
+    std::vector<SoftMesh> swordMeshes(gSwordCpuMeshes.size());
+    size_t aoOffset = 0;
+    for (size_t mi = 0; mi < gSwordCpuMeshes.size(); ++mi) {
+        const ModelMeshCPU& cpu = gSwordCpuMeshes[mi];
+        SoftMesh& m = swordMeshes[mi];
+        m.verts.resize(cpu.verts.size());
+        for (size_t i = 0; i < cpu.verts.size(); ++i) {
+            SoftVertex& v = m.verts[i];
+            v.pos = cpu.verts[i].pos;
+            v.normal = cpu.verts[i].normal;
+            v.color = glm::vec3(1.0f);
+            v.uv = cpu.verts[i].uv;
+            v.ao = gSwordVertexAO.empty() ? 1.0f : gSwordVertexAO[aoOffset + i];
+        }
+        m.indices.assign(cpu.indices.begin(), cpu.indices.end());
+        m.texture = swordOK ? &swordTex : nullptr;
+        aoOffset += cpu.verts.size();
+    }
+
+    // floor: the GL patch (gFloorCells^2 cells, gFloorHalfSize out to the far
+    // plane) around the camera, which stays put for the run; snapped to the
+    // cell grid, so its far edge may sit up to half a cell from the GL one
+    std::vector<ModelVertex> floorVerts;
+    std::vector<unsigned int> floorIndices;
+    int floorHalfCells = std::max(1, gFloorCells / 2);
+    buildFloorPatch(floorHalfCells, gFloorHalfSize / (float)floorHalfCells, glm::vec2(gCamPos.x, gCamPos.z), 0.0f, 0.25f,
+        floorVerts, floorIndices);
+    SoftMesh grid;
+    grid.verts.resize(floorVerts.size());
+    for (size_t i = 0; i < floorVerts.size(); ++i) {
+        SoftVertex& v = grid.verts[i];
+        v.pos = floorVerts[i].pos;
+        v.normal = floorVerts[i].normal;
+        v.color = gFloorColor;
+        v.uv = floorVerts[i].uv;
+    }
+    grid.indices.assign(floorIndices.begin(), floorIndices.end());
+    grid.texture = floorOK ? &floorTex : nullptr;
+
+    SoftRenderer renderer(width, height);
+    std::vector<float> frameMs;
+
+    for (int frame = 0; frame < frames; ++frame) {
+        SoftFrameParams fp;
+        fp.view = glm::lookAt(gCamPos, gCamPos + gCamFront, gCamUp);
+        fp.projection = glm::perspective(glm::radians(gFov), (float)width / (float)height, 0.1f, 500.0f);
+        fp.viewPos = gCamPos;
+        fp.lightPos = currentLightPos();
+        fp.lightColor = gLightColor;
+        fp.ambientStrength = gAmbientStrength;
+        std::copy(gAmbientSH, gAmbientSH + 9, fp.ambientSH);
+        currentSpecular(fp.specStrength, fp.shininess);
+        fp.useBlinnPhong = gUseBlinn;
+        fp.clearColor = gClearColor;
+        fp.skybox = &sky;
+
+        std::vector<SoftDraw> draws;
+        glm::mat4 swordModel = swordModelMatrix();
+        glm::mat3 swordNormal = normalMatrixOf(swordModel);
+        for (const auto& m : swordMeshes) {
+            SoftDraw d;
+            d.mesh = &m;
+            d.model = swordModel;
+            d.normalMatrix = swordNormal;
+            d.selected = gSwordSelected;
+            draws.push_back(d);
+        }
+        if (gShowGrid) {
+            SoftDraw d;
+            d.mesh = &grid;
+            d.lightmap = lightmap.levels.empty() ? nullptr : &lightmap;
+            d.lightmapFromWorld = glm::inverse(swordBakeToWorld());
+            d.lightmapRect = gLightmapRect;
+            draws.push_back(d);
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        renderer.render(fp, draws);
+        frameMs.push_back((float)std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+
+        // fixed step, same as a replay
+        if (!gLightPaused) gLightTime += gReplayDeltaTime;
+    }
+
+    FrameStats stats = computeFrameStats(frameMs);
+    std::cout << "Software renderer " << width << "x" << height << ": " << stats.frames << " frames, mean "
+        << stats.meanMs << " ms, p95 " << stats.p95Ms << " ms\n";
+
+    int exitCode = 0;
+    if (statsPath && !writeFrameStats(statsPath, frameMs)) exitCode = 2;
+    if (!renderer.writePPM(outPath)) {
+        std::cerr << "Failed to write image: " << outPath << "\n";
+        exitCode = 2;
+    }
+    return exitCode;
+}
+
+//----------------------------------------------------------
+//  INPUT
+//----------------------------------------------------------
+static void processInput(GLFWwindow* window)
+{
+    static bool pWasDown = false;
+    bool pDown = keyDown(window, GLFW_KEY_P);
+    if (pDown && !pWasDown) {
+        gCursorEnabled = !gCursorEnabled;
+        glfwSetInputMode(window, GLFW_CURSOR, gCursorEnabled ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+        gFirstMouse = true; // prevent jump when enabling mouse look again
+        std::cout << (gCursorEnabled ? "Cursor ON (picking)\n" : "Cursor OFF (camera look)\n");
+    }
+    pWasDown = pDown;
+
+    static bool oWasDown = false;
+    bool oDown = keyDown(window, GLFW_KEY_O);
+    if (oDown && !oWasDown) {
+        gObjectMode = !gObjectMode;
+        std::cout << (gObjectMode ? "MODE: OBJECT | Press Q/E to rotate \n" : "MODE: CAMERA\n");
+    }
+    oWasDown = oDown;
+
+    if (keyDown(window, GLFW_KEY_ESCAPE))
+        glfwSetWindowShouldClose(window, true);
+
+    gInputHeld =
+        keyDown(window, GLFW_KEY_W) || keyDown(window, GLFW_KEY_S) ||
+        keyDown(window, GLFW_KEY_A) || keyDown(window, GLFW_KEY_D) ||
+        keyDown(window, GLFW_KEY_Q) || keyDown(window, GLFW_KEY_E);
+    if (gInputHeld) gSceneDirty = true;
+
+    float camSpeed = 8.0f * gDeltaTime;
+    glm::vec3 right = glm::normalize(glm::cross(gCamFront, gCamUp));
 
     if (!gObjectMode) {
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) gCamPos += camSpeed * gCamFront;
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) gCamPos -= camSpeed * gCamFront;
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) gCamPos -= right * camSpeed;
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) gCamPos += right * camSpeed;
+        if (keyDown(window, GLFW_KEY_W)) gCamPos += camSpeed * gCamFront;
+        if (keyDown(window, GLFW_KEY_S)) gCamPos -= camSpeed * gCamFront;
+        if (keyDown(window, GLFW_KEY_A)) gCamPos -= right * camSpeed;
+        if (keyDown(window, GLFW_KEY_D)) gCamPos += right * camSpeed;
     }
     else {
         float objMove = 4.0f * gDeltaTime;
         float objRot = 90.0f * gDeltaTime;
 
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) gSwordPos.z -= objMove;
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) gSwordPos.z += objMove;
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) gSwordPos.x -= objMove;
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) gSwordPos.x += objMove;
+        if (keyDown(window, GLFW_KEY_W)) gSwordPos.z -= objMove;
+        if (keyDown(window, GLFW_KEY_S)) gSwordPos.z += objMove;
+        if (keyDown(window, GLFW_KEY_A)) gSwordPos.x -= objMove;
+        if (keyDown(window, GLFW_KEY_D)) gSwordPos.x += objMove;
 
-        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) gSwordYaw += objRot;
-        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) gSwordYaw -= objRot;
+        if (keyDown(window, GLFW_KEY_Q)) gSwordYaw += objRot;
+        if (keyDown(window, GLFW_KEY_E)) gSwordYaw -= objRot;
     }
 
     float floorY = 0.0f;
@@ -582,22 +2559,80 @@ static void processInput(GLFWwindow* window)
     if (gCamPos.y < floorY + eyeHeight) gCamPos.y = floorY + eyeHeight;
 
     static bool f1WasDown = false;
-    bool f1Down = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+    bool f1Down = keyDown(window, GLFW_KEY_F1);
     if (f1Down && !f1WasDown) {
         gWireframe = !gWireframe;
         glPolygonMode(GL_FRONT_AND_BACK, gWireframe ? GL_LINE : GL_FILL);
+        gSceneDirty = true;
     }
     f1WasDown = f1Down;
 
     static bool gWasDown = false;
-    bool gDown = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
-    if (gDown && !gWasDown) gShowGrid = !gShowGrid;
+    bool gDown = keyDown(window, GLFW_KEY_G);
+    if (gDown && !gWasDown) { gShowGrid = !gShowGrid; gSceneDirty = true; }
     gWasDown = gDown;
 
     static bool bWasDown = false;
-    bool bDown = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
-    if (bDown && !bWasDown) gUseBlinn = !gUseBlinn;
+    bool bDown = keyDown(window, GLFW_KEY_B);
+    if (bDown && !bWasDown) { gUseBlinn = !gUseBlinn; gSceneDirty = true; }
     bWasDown = bDown;
+
+    static bool f2WasDown = false;
+    bool f2Down = keyDown(window, GLFW_KEY_F2);
+    if (f2Down && !f2WasDown) {
+        gDynamicRes = !gDynamicRes;
+        gRenderScale = 1.0f;
+        gGpuFrameMsAvg = 0.0f;
+        std::cout << (gDynamicRes ? "Dynamic resolution ON\n" : "Dynamic resolution OFF\n");
+        gSceneDirty = true;
+    }
+    f2WasDown = f2Down;
+
+    static bool f3WasDown = false;
+    bool f3Down = keyDown(window, GLFW_KEY_F3);
+    if (f3Down && !f3WasDown) {
+        gRenderOnDemand = !gRenderOnDemand;
+        gSceneDirty = true;
+        std::cout << (gRenderOnDemand ? "Render on demand ON\n" : "Render on demand OFF (continuous)\n");
+    }
+    f3WasDown = f3Down;
+
+    static bool lWasDown = false;
+    bool lDown = keyDown(window, GLFW_KEY_L);
+    if (lDown && !lWasDown) {
+        gLightPaused = !gLightPaused;
+        gSceneDirty = true;
+        std::cout << (gLightPaused ? "Light animation paused\n" : "Light animation running\n");
+    }
+    lWasDown = lDown;
+
+    static bool f4WasDown = false;
+    bool f4Down = keyDown(window, GLFW_KEY_F4);
+    if (f4Down && !f4WasDown) {
+        gUseUberShader = !gUseUberShader;
+        gSceneDirty = true;
+        std::cout << (gUseUberShader ? "Uber shader ON\n" : "Uber shader OFF (compiled variants)\n");
+    }
+    f4WasDown = f4Down;
+
+    static bool f5WasDown = false;
+    bool f5Down = keyDown(window, GLFW_KEY_F5);
+    if (f5Down && !f5WasDown) {
+        gParticlesEnabled = !gParticlesEnabled;
+        gSceneDirty = true;
+        std::cout << (gParticlesEnabled ? "Particles ON\n" : "Particles OFF\n");
+    }
+    f5WasDown = f5Down;
+
+    static bool f6WasDown = false;
+    bool f6Down = keyDown(window, GLFW_KEY_F6);
+    if (f6Down && !f6WasDown) {
+        gGpuCullingEnabled = !gGpuCullingEnabled;
+        gSwordField.hizValid = false; // the pyramid stopped following the scene
+        gSceneDirty = true;
+        std::cout << (gGpuCullingEnabled ? "GPU culling ON\n" : "GPU culling OFF (sword field drawn unculled)\n");
+    }
+    f6WasDown = f6Down;
 }
 static glm::vec3 screenToWorldRay(
     GLFWwindow* window,
@@ -605,43 +2640,111 @@ static glm::vec3 screenToWorldRay(
     const glm::mat4& view
 ) {
     double mx, my;
-    glfwGetCursorPos(window, &mx, &my);
+    if (gInputMode == INPUT_REPLAY) { mx = gLastX; my = gLastY; }
+    else glfwGetCursorPos(window, &mx, &my);
 
     int w, h;
     glfwGetWindowSize(window, &w, &h);
-
-    // Normalized Device Coordinates (-1..1)
-    float x = (2.0f * (float)mx) / (float)w - 1.0f;
-    float y = 1.0f - (2.0f * (float)my) / (float)h; // flip Y
-    glm::vec4 rayClip(x, y, -1.0f, 1.0f);
-
-    // Eye space
-    glm::vec4 rayEye = glm::inverse(projection) * rayClip;
-    rayEye = glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f);
-
-    // World space
-    glm::vec3 rayWorld = glm::normalize(glm::vec3(glm::inverse(view) * rayEye));
-    return rayWorld;
-}
-
-static bool raySphereIntersect(
-    const glm::vec3& rayOrigin,
-    const glm::vec3& rayDir,
-    const glm::vec3& sphereCenter,
-    float sphereRadius
-) {
-    glm::vec3 oc = rayOrigin - sphereCenter;
-    float b = glm::dot(oc, rayDir);
-    float c = glm::dot(oc, oc) - sphereRadius * sphereRadius;
-    float h = b * b - c;
-    return h >= 0.0f;
+    return screenPointToWorldRay((float)mx, (float)my, w, h, projection, view);
 }
 
 //==============================================================
 //  MAIN
 //==============================================================
-int main()
+int main(int argc, char** argv)
 {
+    //----------------------------------------------------------
+    // 0) Command line
+    //----------------------------------------------------------
+    //   --record <file>             capture input to a replay file
+    //   --replay <file>             replay at a fixed time step, then exit
+    //   --stats <file>              frame-time statistics of the replay
+    //   --baseline <file>           compare the replay stats against a stored baseline
+    //   --compare <base> <current>  compare two stats files and exit
+    //   --threshold <fraction>      allowed slowdown before failing (default 0.05)
+    //   --software <out.ppm>        render on the CPU without a window, then exit
+    //   --size <W>x<H>              software image size (default 800x600)
+    //   --frames <n>                frames to render and time (software 1, particle bench 300)
+    //   --uber                      start with the runtime-branching uber shader
+    //   --shader-bench <frames>     GPU time of shader variants vs uber shader, then exit
+    //   --particles <n>             enable particles with this budget (off by default, e.g. 65536)
+    //   --bench-particles <n>       time n particles in a hidden window, then exit
+    //   --render-stats <file|->     per-pass GL call counts as CSV, or "-" for stdout (RENDER_STATS builds)
+    //   --capture <dir|file.y4m>    record presented frames as PNGs (one per frame, no timing)
+    //                               or an I420 video (replay step rate, live runs paced to 60 Hz wall clock)
+    //   --sword-field <n>           n extra swords, frustum + Hi-Z culled on the GPU (GL 4.3)
+    //
+    // Linux build (--software runs before GLFW is initialised, so it works on headless nodes;
+    // the binary still links GLFW and glad, which just sit unused there):
+    //   g++ -std=c++14 -O2 -pthread -I<glad>/include 100728418_Graphics_Project1.cpp FrameCapture.cpp
+    //       LightBaker.cpp RenderStats.cpp SceneKernels.cpp SkyIrradiance.cpp SoftRasterizer.cpp
+    //       SoftRasterizerAVX2.cpp <glad>/src/glad.c -lglfw -lassimp -ldl -o Graphics_Project1
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    const char* statsPath = nullptr;
+    const char* baselinePath = nullptr;
+    const char* comparePaths[2] = { nullptr, nullptr };
+    float regressionThreshold = 0.05f;
+    const char* softwarePath = nullptr;
+    int softwareW = 800, softwareH = 600;
+    int framesArg = 0;
+    int shaderBenchFrames = 0;
+    int particleBenchCount = 0;
+    const char* renderStatsPath = nullptr;
+    const char* capturePath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--record" && hasValue) recordPath = argv[++i];
+        else if (arg == "--replay" && hasValue) replayPath = argv[++i];
+        else if (arg == "--stats" && hasValue) statsPath = argv[++i];
+        else if (arg == "--baseline" && hasValue) baselinePath = argv[++i];
+        else if (arg == "--threshold" && hasValue) regressionThreshold = (float)atof(argv[++i]);
+        else if (arg == "--compare" && i + 2 < argc) { comparePaths[0] = argv[++i]; comparePaths[1] = argv[++i]; }
+        else if (arg == "--software" && hasValue) softwarePath = argv[++i];
+        else if (arg == "--size" && hasValue) sscanf(argv[++i], "%dx%d", &softwareW, &softwareH);
+        else if (arg == "--frames" && hasValue) framesArg = std::max(1, atoi(argv[++i]));
+        else if (arg == "--uber") gUseUberShader = true;
+        else if (arg == "--shader-bench" && hasValue) shaderBenchFrames = std::max(1, atoi(argv[++i]));
+        else if (arg == "--particles" && hasValue) gParticleCount = std::max(0, atoi(argv[++i]));
+        else if (arg == "--bench-particles" && hasValue) particleBenchCount = std::max(1, atoi(argv[++i]));
+        else if (arg == "--render-stats" && hasValue) renderStatsPath = argv[++i];
+        else if (arg == "--capture" && hasValue) capturePath = argv[++i];
+        else if (arg == "--sword-field" && hasValue) gSwordFieldCount = std::max(0, atoi(argv[++i]));
+        else std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+    }
+
+    if (comparePaths[0])
+        return compareFrameStats(comparePaths[0], comparePaths[1], regressionThreshold);
+
+    if (softwarePath)
+        return runSoftwareRenderer(softwarePath, std::max(1, softwareW), std::max(1, softwareH), framesArg > 0 ? framesArg : 1, statsPath);
+
+    if (replayPath && !loadInputReplay(replayPath)) return -1;
+
+    // frame stats only compare like with like
+    if (replayPath && (int)gRecordHeader.particleCount != gParticleCount) {
+        std::cerr << "Replay was recorded with --particles " << gRecordHeader.particleCount
+            << ", this run uses " << gParticleCount << "\n";
+        return -1;
+    }
+    if (replayPath && (int)gRecordHeader.swordFieldCount != gSwordFieldCount) {
+        std::cerr << "Replay was recorded with --sword-field " << gRecordHeader.swordFieldCount
+            << ", this run uses " << gSwordFieldCount << "\n";
+        return -1;
+    }
+
+    if (renderStatsPath) {
+#ifdef RENDER_STATS
+        if (!renderStatsOpen(renderStatsPath)) return -1;
+#else
+        std::cerr << "--render-stats needs a build with RENDER_STATS defined, ignoring.\n";
+#endif
+    }
+    if (baselinePath && !statsPath) statsPath = "replay_stats.txt";
+
     //----------------------------------------------------------
     // 1) Window + GL init
     //----------------------------------------------------------
@@ -651,6 +2754,7 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_DEPTH_BITS, 24);
+    if (particleBenchCount > 0) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow* window = glfwCreateWindow(800, 600, "CrimsonSword", nullptr, nullptr);
     glfwMakeContextCurrent(window);
@@ -661,9 +2765,16 @@ int main()
         glfwTerminate();
         return -1;
     }
+
+    if (particleBenchCount > 0) {
+        int code = runParticleBenchmark(particleBenchCount, framesArg > 0 ? framesArg : 300, statsPath);
+        glfwTerminate();
+        return code;
+    }
     
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
@@ -671,8 +2782,9 @@ int main()
     //----------------------------------------------------------
     // 2) Programs
     //----------------------------------------------------------
-    GLuint program = createProgram("shaders/vertex.glsl", "shaders/fragment.glsl");
+    warmScenePrograms(gSwordFieldCount > 0);
     GLuint skyboxProgram = createProgram("shaders/skybox.vert", "shaders/skybox.frag");
+    GLuint upscaleProgram = createProgram("shaders/upscale.vert", "shaders/upscale.frag");
     glUseProgram(skyboxProgram);
     GLint skyLoc = glGetUniformLocation(skyboxProgram, "skybox");
      
@@ -684,34 +2796,39 @@ int main()
     
   
     //
-    std::cout << "------------Menu------------" << gSwordMeshes.size() << "\n";
-    std::cout << "press O, to toggle between camera and object (sword)" << gSwordMeshes.size() << "\n";
-    std::cout << "press G to remmove floor" << gSwordMeshes.size() << "\n";
-    std::cout << "press B to switch to BillPhong Lighting" << gSwordMeshes.size() << "\n";
-    std::cout << "press F1 to  see wireframe" << gSwordMeshes.size() << "\n";
-    std::cout << "----------------------------" << gSwordMeshes.size() << "\n";
+    std::cout << "------------Menu------------" << gSwordCpuMeshes.size() << "\n";
+    std::cout << "press O, to toggle between camera and object (sword)" << gSwordCpuMeshes.size() << "\n";
+    std::cout << "press G to remmove floor" << gSwordCpuMeshes.size() << "\n";
+    std::cout << "press B to switch to BillPhong Lighting" << gSwordCpuMeshes.size() << "\n";
+    std::cout << "press F1 to  see wireframe" << gSwordCpuMeshes.size() << "\n";
+    std::cout << "press F2 to toggle dynamic resolution\n";
+    std::cout << "press F3 to toggle render on demand, L to pause the light\n";
+    std::cout << "press F4 to toggle the uber shader (vs compiled variants)\n";
+    std::cout << "press F5 to toggle particles (enable with --particles <n>)\n";
+    std::cout << "press F6 to toggle GPU culling of the sword field (--sword-field)\n";
+    std::cout << "----------------------------" << gSwordCpuMeshes.size() << "\n";
 
     // texture loading
     
-    bool swordOK = loadSwordToGPU("assets/models/myModel/sword.obj");
+    bool swordOK = loadSwordMeshes("assets/models/myModel/sword.obj");
+    int floorMaterial = addMaterial("assets/textures/floor.jpg");
+    int swordMaterial = addMaterial("assets/textures/sword.png");
+    for (auto& m : gSwordCpuMeshes) m.material = swordMaterial;
+    buildMaterialArrays();
+    if (gMaterials[floorMaterial].array < 0) std::cerr << "Texture failed to load.\n";
+    if (gMaterials[swordMaterial].array < 0) std::cerr << "Sword texture failed to load.\n";
+
+    swordOK = swordOK && uploadSwordToGPU();
     if (!swordOK) std::cerr << "Sword load/upload failed.\n";
-    GLuint floorTex = loadTexture2D("assets/textures/floor.jpg");
-    if (floorTex == 0) std::cerr << "Texture failed to load.\n";
-    GLuint swordTex = loadTexture2D("assets/textures/sword.png");
-    if (swordTex == 0) std::cerr << "Sword texture failed to load.\n";
-    //
-    for (auto& m : gSwordMeshes) m.diffuseTex = swordTex;
 
-    std::vector<std::string> faces = {
-       "assets/skybox/right.png",
-       "assets/skybox/left.png",
-       "assets/skybox/top.png",
-       "assets/skybox/bottom.png",
-       "assets/skybox/front.png",
-       "assets/skybox/back.png"
-    };
+    // aAO (4) defaults to unoccluded for anything without a baked buffer
+    glVertexAttrib1f(4, 1.0f);
+    bakeStaticAmbientOcclusion();
+
+    if (gParticleCount > 0 && !initParticleSystem(gParticles, gParticleCount, defaultSwordEmitters())) gParticleCount = 0;
+    if (gSwordFieldCount > 0 && !initSwordField(gSwordField, gSwordFieldCount)) gSwordFieldCount = 0;
 
-    GLuint cubemapTex = loadCubemap(faces);
+    GLuint cubemapTex = loadCubemap(skyboxFaces());
     if (cubemapTex == 0) {
         std::cerr << "Cubemap texture is 0 (failed). Skybox will be black.\n";
     }
@@ -720,31 +2837,12 @@ int main()
     glUniform1i(glGetUniformLocation(skyboxProgram, "skybox"), 0);
 
     //----------------------------------------------------------
-    // 4) Build Grid VAO/VBO
+    // 4) Floor VAO
     //----------------------------------------------------------
-    std::vector<float> verts = buildGridFloor(25, 1.0f, 0.0f, 0.6f, 0.6f, 0.65f);
-
-    GLuint gridVAO = 0, gridVBO = 0;
-    glGenVertexArrays(1, &gridVAO);
-    glGenBuffers(1, &gridVBO);
-
-    glBindVertexArray(gridVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
-    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(9 * sizeof(float)));
-    glEnableVertexAttribArray(3);
-
-    glBindVertexArray(0);
+    // the floor is generated from gl_VertexID, so its VAO has no arrays:
+    // every attribute comes from the constants set before the draw
+    GLuint floorVAO = 0;
+    glGenVertexArrays(1, &floorVAO);
 
     //----------------------------------------------------------
     // 5) Build Skybox VAO/VBO  
@@ -806,32 +2904,60 @@ int main()
     glBindVertexArray(0);
 
     //----------------------------------------------------------
-    // 6) Uniform locations for main program
+    // 5b) Offscreen scene target (dynamic resolution)
     //----------------------------------------------------------
-    glUseProgram(program);
-
-    glUniform1f(glGetUniformLocation(program, "constantAtt"), 1.0f);
-    glUniform1f(glGetUniformLocation(program, "linearAtt"), 0.09f);
-    glUniform1f(glGetUniformLocation(program, "quadraticAtt"), 0.032f);
+    // fullscreen triangle is generated from gl_VertexID, core profile still wants a VAO bound
+    GLuint fullscreenVAO = 0;
+    glGenVertexArrays(1, &fullscreenVAO);
 
-    int viewLoc = glGetUniformLocation(program, "view");
-    int projLoc = glGetUniformLocation(program, "projection");
-    int modelLoc = glGetUniformLocation(program, "model");
-    int normalMatrixLoc = glGetUniformLocation(program, "normalMatrix");
+    SceneTarget sceneTarget;
+    GpuFrameTimer gpuTimer;
+    initGpuFrameTimer(gpuTimer);
 
-    int viewPosLoc = glGetUniformLocation(program, "viewPos");
-    int lightPosLoc = glGetUniformLocation(program, "lightPos");
-    int lightColorLoc = glGetUniformLocation(program, "lightColor");
-
-    int ambientLoc = glGetUniformLocation(program, "ambientStrength");
-    int specStrLoc = glGetUniformLocation(program, "specStrength");
-    int shininessLoc = glGetUniformLocation(program, "shininess");
-    int useBlinnLoc = glGetUniformLocation(program, "useBlinnPhong");
+    glUseProgram(upscaleProgram);
+    glUniform1i(glGetUniformLocation(upscaleProgram, "uScene"), 0);
+    glUniform1i(glGetUniformLocation(upscaleProgram, "uSceneDepth"), 1);
+    GLint upUVScaleLoc = glGetUniformLocation(upscaleProgram, "uUVScale");
+    GLint upTexelLoc = glGetUniformLocation(upscaleProgram, "uTexelSize");
+    GLint upSharpLoc = glGetUniformLocation(upscaleProgram, "uSharpness");
 
+    //----------------------------------------------------------
+    // 6) Input + run mode
+    //----------------------------------------------------------
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+    // replays measure frame time, so don't let vsync cap them
+    std::vector<float> replayFrameMs;
+    const int replayWarmupFrames = 10;
+    int replayFrame = 0;
+    if (gInputMode == INPUT_REPLAY) {
+        glfwSwapInterval(0);
+        applyInitialState(window);
+        std::cout << "Replaying " << replayPath << "\n";
+    }
+    else if (recordPath) {
+        startInputRecording(window, recordPath);
+    }
+
+    // permutations vs uber shader on a still scene, GPU time only
+    ShaderBenchmark shaderBench;
+    if (shaderBenchFrames > 0) {
+        glfwSwapInterval(0);
+        startShaderBenchmark(shaderBench, shaderBenchFrames);
+    }
+    uint64_t frameIndex = 0;
+
+    // replays capture one frame per fixed step; live frame times vary (vsync,
+    // render on demand idling), so live video is resampled to 60 Hz by wall clock
+    FrameCapture capture;
+    if (capturePath) {
+        bool live = gInputMode != INPUT_REPLAY;
+        int captureFps = live ? 60 : (int)(1.0f / gReplayDeltaTime + 0.5f);
+        if (!capture.start(capturePath, captureFps, live)) glfwSetWindowShouldClose(window, true);
+    }
+
     //----------------------------------------------------------
     // 7) Render loop
     //----------------------------------------------------------
@@ -841,92 +2967,162 @@ int main()
         gDeltaTime = currentFrame - gLastFrame;
         gLastFrame = currentFrame;
 
+        if (gInputMode == INPUT_REPLAY) {
+            if (++replayFrame > replayWarmupFrames) replayFrameMs.push_back(gDeltaTime * 1000.0f);
+            gDeltaTime = gReplayDeltaTime;
+            if (!advanceInputReplay(window)) glfwSetWindowShouldClose(window, true);
+        }
+        else if (gInputMode == INPUT_RECORD) {
+            recordKeyState(window);
+        }
+
         processInput(window);
 
-        glClearColor(0.05f, 0.06f, 0.08f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // idle: nothing moved and nothing animates, so sleep until an event arrives
+        bool particlesAnimate = gParticlesEnabled && gParticles.count > 0;
+        if (gRenderOnDemand && gInputMode != INPUT_REPLAY && !gSceneDirty && !gInputHeld && gLightPaused && !particlesAnimate) {
+            glfwWaitEventsTimeout(gIdleWaitSeconds);
+            gLastFrame = (float)glfwGetTime(); // time spent asleep is not a simulation step
+            continue;
+        }
+        gSceneDirty = false;
+        RENDER_STATS_BEGIN_FRAME();
 
-        // Build view/proj
-        glm::mat4 view = glm::lookAt(gCamPos, gCamPos + gCamFront, gCamUp);
+        if (!gLightPaused) gLightTime += gDeltaTime;
+
+        float gpuMs = 0.0f;
+        bool gpuMsValid = pollGpuFrameTimer(gpuTimer, gpuMs);
+        if (gpuMsValid && gDynamicRes)
+            updateRenderScale(gpuMs);
+        if (shaderBenchFrames > 0 && !advanceShaderBenchmark(shaderBench, gpuMsValid, gpuMs))
+            glfwSetWindowShouldClose(window, true);
+        beginGpuFrameTimer(gpuTimer);
 
         int fbw, fbh;
         glfwGetFramebufferSize(window, &fbw, &fbh);
         float aspect = (fbh == 0) ? 1.0f : (float)fbw / (float)fbh;
 
-        glm::mat4 projection = glm::perspective(glm::radians(gFov), aspect, 0.1f, 500.0f);
-        gLastView = view;
-        gLastProj = projection;
+        // scene pass goes offscreen at a reduced size when dynamic resolution is on,
+        // and at full size when GPU culling needs its depth for the Hi-Z pyramid
+        bool sceneOffscreen = gDynamicRes || swordFieldUsesHiZ(gSwordField);
+        int sceneW = fbw, sceneH = fbh;
+        if (sceneOffscreen) {
+            resizeSceneTarget(sceneTarget, fbw, fbh);
+            if (gDynamicRes) {
+                sceneW = std::max(1, (int)(fbw * gRenderScale + 0.5f));
+                sceneH = std::max(1, (int)(fbh * gRenderScale + 0.5f));
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, sceneTarget.fbo);
+        }
+        glViewport(0, 0, sceneW, sceneH);
 
-        //----------------------------------------------------------
-        // Draw: Sword + Grid (main shader)
-        //----------------------------------------------------------
-        glUseProgram(program);
+        glClearColor(gClearColor.x, gClearColor.y, gClearColor.z, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-        glUniform3fv(viewPosLoc, 1, glm::value_ptr(gCamPos));
+        // Build view/proj
+        glm::mat4 view = glm::lookAt(gCamPos, gCamPos + gCamFront, gCamUp);
 
-        // moving light
-        
-        float t = (float)glfwGetTime();
-        float ang = t * gLightSpeed;
+        glm::mat4 projection = glm::perspective(glm::radians(gFov), aspect, 0.1f, 500.0f);
+        gLastView = view;
+        gLastProj = projection;
 
-        glm::vec3 lightPos(
-            gLightRadius* cos(ang),
-            gLightHeight,
-            gLightRadius* sin(ang)
-        );
+        // particles step before anything draws; a long hitch is clamped so they don't scatter
+        RENDER_STATS_PASS("particle-update");
+        if (particlesAnimate) updateParticles(gParticles, std::min(gDeltaTime, 0.1f));
 
-        glm::vec3 lightColor(1.9f, 1.4f, 1.2f);
-        glUniform3fv(lightPosLoc, 1, glm::value_ptr(lightPos));
-        glUniform3fv(lightColorLoc, 1, glm::value_ptr(lightColor));
+        // sword field visibility, against last frame's depth
+        RENDER_STATS_PASS("cull");
+        cullSwordField(gSwordField, projection * view);
 
-        glUniform1f(ambientLoc, 0.18f);
-        if (gUseBlinn) {
-            glUniform1f(specStrLoc, 2.0f);     
-            glUniform1f(shininessLoc, 256.0f);  
-        }
-        else {
-            glUniform1f(specStrLoc, 0.8f);     
-            glUniform1f(shininessLoc, 16.0f); 
+        //----------------------------------------------------------
+        // Draw: Sword + Grid (scene shader variants)
+        //----------------------------------------------------------
+        RENDER_STATS_PASS("scene");
+        SceneFrameUniforms frameUniforms;
+        frameUniforms.frame = ++frameIndex;
+        frameUniforms.view = view;
+        frameUniforms.projection = projection;
+        frameUniforms.viewPos = gCamPos;
+        frameUniforms.lightPos = currentLightPos(); // moving light
+        currentSpecular(frameUniforms.specStrength, frameUniforms.shininess);
+        // baked contact AO follows the sword around
+        frameUniforms.lightmapFromWorld = glm::inverse(swordBakeToWorld());
+        frameUniforms.lightmapRect = gLightmapRect;
+
+        unsigned lightingFeatures = gUseBlinn ? SHADER_BLINN_PHONG : 0u;
+
+        drawSword(lightingFeatures | (gSwordSelected ? SHADER_SELECTED : 0u), frameUniforms);
+        drawSwordField(gSwordField, lightingFeatures, frameUniforms);
+
+        // floor: camera-centred patch out to the far plane, the lightmap
+        // still lines up because the fragment shader maps world position
+        if (gShowGrid) {
+            unsigned floorFeatures = lightingFeatures | SHADER_PROCEDURAL_FLOOR;
+            const Material& floorMat = gMaterials[floorMaterial];
+            if (floorMat.array >= 0) floorFeatures |= SHADER_USE_TEXTURE;
+            if (gFloorLightmapTex != 0) floorFeatures |= SHADER_USE_LIGHTMAP;
+
+            SceneProgram& floorProgram = useSceneProgram(floorFeatures, frameUniforms);
+            glm::mat3 floorNormal(1.0f);
+            glUniformMatrix3fv(floorProgram.normalMatrix, 1, GL_FALSE, glm::value_ptr(floorNormal));
+            glUniform4f(floorProgram.floorPatch, gCamPos.x, 0.0f, gCamPos.z, gFloorHalfSize);
+            glUniform1i(floorProgram.floorCells, gFloorCells);
+
+            glVertexAttrib3f(1, 0.0f, 1.0f, 0.0f);
+            glVertexAttrib3f(2, gFloorColor.x, gFloorColor.y, gFloorColor.z);
+            glVertexAttrib1f(5, (float)floorMat.layer);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, floorMat.array >= 0 ? gMaterialArrays[floorMat.array].tex : 0);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, gFloorLightmapTex);
+            glActiveTexture(GL_TEXTURE0);
+
+            glBindVertexArray(floorVAO);
+            glDrawArrays(GL_TRIANGLES, 0, gFloorCells * gFloorCells * 6);
+            glBindVertexArray(0);
         }
 
-        glUniform1i(useBlinnLoc, gUseBlinn ? 1 : 0);
-
-        // sword model matrix
-        glm::mat4 swordModel(1.0f);
-        swordModel = glm::translate(swordModel, gSwordPos);
-        swordModel = glm::rotate(swordModel, glm::radians(gSwordYaw), glm::vec3(0, 1, 0));
-        swordModel = glm::scale(swordModel, glm::vec3(gSwordScale));
-        glm::mat3 swordNormal = glm::transpose(glm::inverse(glm::mat3(swordModel)));
-
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(swordModel));
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(swordNormal));
-        glUniform1i(glGetUniformLocation(program, "uSelected"), gSwordSelected ? 1 : 0);
-
-        drawSword(program);
-        glUniform1i(glGetUniformLocation(program, "uSelected"), 0);
-
-        // grid
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, floorTex);
-        glUniform1i(glGetUniformLocation(program, "uTex"), 0);
-        glUniform1i(glGetUniformLocation(program, "uUseTexture"), 1);
-
-        glm::mat4 gridModel(1.0f);
-        glm::mat3 gridNormal = glm::transpose(glm::inverse(glm::mat3(gridModel)));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(gridModel));
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(gridNormal));
+        if (sceneOffscreen) {
+            RENDER_STATS_PASS("hi-z");
+            buildHiZ(gSwordField, sceneTarget, sceneW, sceneH, projection * view);
+        }
 
-        if (gShowGrid) {
-            glBindVertexArray(gridVAO);
-            glDrawArrays(GL_TRIANGLES, 0, (int)(verts.size() / 11));
+        //----------------------------------------------------------
+        //  upscale scene to backbuffer (offscreen scene only)
+        //----------------------------------------------------------
+        if (sceneOffscreen) {
+            RENDER_STATS_PASS("upscale");
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, fbw, fbh);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // fill mode: wireframe toggle only applies to the scene itself
+            if (gWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            glDepthFunc(GL_ALWAYS);
+
+            glUseProgram(upscaleProgram);
+            glUniform2f(upUVScaleLoc, (float)sceneW / (float)sceneTarget.width, (float)sceneH / (float)sceneTarget.height);
+            glUniform2f(upTexelLoc, 1.0f / (float)sceneTarget.width, 1.0f / (float)sceneTarget.height);
+            glUniform1f(upSharpLoc, gRenderScale < 1.0f ? gUpscaleSharpness : 0.0f);
+
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, sceneTarget.depthTex);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, sceneTarget.colorTex);
+
+            glBindVertexArray(fullscreenVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
             glBindVertexArray(0);
+
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glDepthFunc(GL_LESS);
+            if (gWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
         }
 
         //----------------------------------------------------------
   //  skybox  
   //----------------------------------------------------------
+        RENDER_STATS_PASS("skybox");
         glDepthFunc(GL_LEQUAL);
         glDepthMask(GL_FALSE);
 
@@ -947,31 +3143,59 @@ int main()
         glDepthMask(GL_TRUE);
         glDepthFunc(GL_LESS);
 
+        //----------------------------------------------------------
+        //  particles (after the sky: additive, no depth writes)
+        //----------------------------------------------------------
+        RENDER_STATS_PASS("particles");
+        if (gParticlesEnabled) drawParticles(gParticles, view, projection);
+
+        endGpuFrameTimer(gpuTimer);
+        if (capture.active()) capture.capture(0, fbw, fbh);
+        RENDER_STATS_END_FRAME();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    int exitCode = 0;
+    capture.finish();
+    if (gInputMode == INPUT_RECORD) finishInputRecording();
+    if (gInputMode == INPUT_REPLAY && statsPath) {
+        if (!writeFrameStats(statsPath, replayFrameMs)) exitCode = 2;
+        else if (baselinePath) exitCode = compareFrameStats(baselinePath, statsPath, regressionThreshold);
+    }
+#ifdef RENDER_STATS
+    if (renderStatsPath) renderStatsClose();
+#endif
+
     //----------------------------------------------------------
     // Cleanup
     //----------------------------------------------------------
-    glDeleteBuffers(1, &gridVBO);
-    glDeleteVertexArrays(1, &gridVAO);
+    glDeleteVertexArrays(1, &floorVAO);
 
     glDeleteBuffers(1, &skyboxVBO);
     glDeleteVertexArrays(1, &skyboxVAO);
     glDeleteTextures(1, &cubemapTex);
 
-    glDeleteProgram(skyboxProgram);
-    glDeleteProgram(program);
+    destroySceneTarget(sceneTarget);
+    if (gFloorLightmapTex) glDeleteTextures(1, &gFloorLightmapTex);
+    glDeleteVertexArrays(1, &fullscreenVAO);
+    glDeleteQueries(kGpuTimerRing, gpuTimer.queries);
 
-    for (auto& m : gSwordMeshes) {
-        if (m.EBO) glDeleteBuffers(1, &m.EBO);
-        if (m.VBO) glDeleteBuffers(1, &m.VBO);
-        if (m.VAO) glDeleteVertexArrays(1, &m.VAO);
-    }
-    gSwordMeshes.clear();
+    glDeleteProgram(upscaleProgram);
+    glDeleteProgram(skyboxProgram);
+    destroyScenePrograms();
+    destroyParticleSystem(gParticles);
+    destroySwordField(gSwordField);
+
+    if (gSwordGL.layerVBO) glDeleteBuffers(1, &gSwordGL.layerVBO);
+    if (gSwordGL.aoVBO) glDeleteBuffers(1, &gSwordGL.aoVBO);
+    if (gSwordGL.EBO) glDeleteBuffers(1, &gSwordGL.EBO);
+    if (gSwordGL.VBO) glDeleteBuffers(1, &gSwordGL.VBO);
+    if (gSwordGL.VAO) glDeleteVertexArrays(1, &gSwordGL.VAO);
+    gSwordGL = BatchedMeshGL();
+    destroyMaterialArrays();
 
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
@@ -0,0 +1,385 @@
+#include "FrameCapture.h"
+
+#include <glad/glad.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+//----------------------------------------------------------
+//  STATE
+//----------------------------------------------------------
+// RGBA8 rows as glReadPixels returns them (bottom row first)
+struct CaptureFrame {
+    uint64_t index = 0; // PNG file number, or position on the video timeline
+    int width = 0, height = 0;
+    std::vector<unsigned char> rgba;
+};
+
+struct ReadbackSlot {
+    GLuint pbo = 0;
+    GLsync fence = nullptr;
+    size_t size = 0;
+    int width = 0, height = 0;
+    uint64_t index = 0;
+    bool pending = false;
+};
+
+struct FrameCaptureState {
+    bool active = false;
+    bool y4m = false;
+    bool realTime = false; // video only
+    std::string path;
+    int fps = 60;
+    bool clockStarted = false;
+    std::chrono::steady_clock::time_point clockStart;
+
+    std::vector<ReadbackSlot> ring;
+    size_t nextSlot = 0;
+    uint64_t nextIndex = 0;
+
+    // frames go pool -> work queue -> encoder -> pool; the pool never grows past maxQueued
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::unique_ptr<CaptureFrame>> frames;
+    std::vector<CaptureFrame*> freeFrames;
+    std::deque<CaptureFrame*> work;
+    size_t maxQueued = 8;
+    bool stopping = false;
+    std::vector<std::thread> encoders;
+
+    FILE* video = nullptr;
+    int videoW = 0, videoH = 0;
+    uint64_t videoFrames = 0;        // frames in the file so far (encoder thread)
+    std::vector<unsigned char> lastYUV; // repeated to fill timeline gaps (encoder thread)
+
+    FrameCaptureStats stats; // guarded by mutex
+};
+
+//----------------------------------------------------------
+//  ENCODERS (worker threads)
+//----------------------------------------------------------
+static bool writePNG(const FrameCaptureState& s, const CaptureFrame& f)
+{
+    // flip to top-down and drop alpha: the back buffer's alpha is whatever blending left there
+    std::vector<unsigned char> rgb((size_t)f.width * f.height * 3);
+    for (int y = 0; y < f.height; ++y) {
+        const unsigned char* src = &f.rgba[(size_t)(f.height - 1 - y) * f.width * 4];
+        unsigned char* dst = &rgb[(size_t)y * f.width * 3];
+        for (int x = 0; x < f.width; ++x, src += 4, dst += 3) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "/frame_%05llu.png", (unsigned long long)f.index);
+    std::string file = s.path + name;
+    if (!stbi_write_png(file.c_str(), f.width, f.height, 3, rgb.data(), f.width * 3)) {
+        std::cerr << "Failed to write capture " << file << "\n";
+        return false;
+    }
+    return true;
+}
+
+// BT.601 limited range, 2x2 averaged chroma (I420)
+static bool writeY4M(FrameCaptureState& s, const CaptureFrame& f)
+{
+    int w = f.width & ~1, h = f.height & ~1;
+    if (s.videoW == 0) {
+        s.videoW = w;
+        s.videoH = h;
+        fprintf(s.video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", w, h, s.fps);
+    }
+    if (w != s.videoW || h != s.videoH) return false; // resized mid-recording, the stream can't change size
+
+    std::vector<unsigned char> yuv((size_t)w * h * 3 / 2);
+    unsigned char* Y = yuv.data();
+    unsigned char* U = Y + (size_t)w * h;
+    unsigned char* V = U + (size_t)(w / 2) * (h / 2);
+
+    for (int y = 0; y < h; ++y) {
+        const unsigned char* src = &f.rgba[(size_t)(f.height - 1 - y) * f.width * 4];
+        for (int x = 0; x < w; ++x, src += 4)
+            Y[(size_t)y * w + x] = (unsigned char)(((66 * src[0] + 129 * src[1] + 25 * src[2] + 128) >> 8) + 16);
+    }
+    for (int y = 0; y < h / 2; ++y) {
+        const unsigned char* row0 = &f.rgba[(size_t)(f.height - 1 - 2 * y) * f.width * 4];
+        const unsigned char* row1 = &f.rgba[(size_t)(f.height - 2 - 2 * y) * f.width * 4];
+        for (int x = 0; x < w / 2; ++x) {
+            const unsigned char* p[4] = { row0 + x * 8, row0 + x * 8 + 4, row1 + x * 8, row1 + x * 8 + 4 };
+            int r = 0, g = 0, b = 0;
+            for (int k = 0; k < 4; ++k) { r += p[k][0]; g += p[k][1]; b += p[k][2]; }
+            r = (r + 2) >> 2; g = (g + 2) >> 2; b = (b + 2) >> 2;
+            U[(size_t)y * (w / 2) + x] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            V[(size_t)y * (w / 2) + x] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    // frames are in timeline order; anything skipped since the last one shows the last one
+    bool ok = true;
+    if (!s.lastYUV.empty() && f.index > s.videoFrames) {
+        uint64_t gap = f.index - s.videoFrames;
+        for (uint64_t i = 0; i < gap && ok; ++i) {
+            fputs("FRAME\n", s.video);
+            ok = fwrite(s.lastYUV.data(), 1, s.lastYUV.size(), s.video) == s.lastYUV.size();
+        }
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.stats.repeated += gap;
+    }
+
+    fputs("FRAME\n", s.video);
+    ok = ok && fwrite(yuv.data(), 1, yuv.size(), s.video) == yuv.size();
+    s.videoFrames = std::max(s.videoFrames, f.index) + 1;
+    s.lastYUV.swap(yuv);
+    return ok;
+}
+
+static void encoderLoop(FrameCaptureState* s)
+{
+    for (;;) {
+        CaptureFrame* f = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(s->mutex);
+            s->wake.wait(lock, [s] { return s->stopping || !s->work.empty(); });
+            if (s->work.empty()) return; // stopping and drained
+            f = s->work.front();
+            s->work.pop_front();
+        }
+
+        bool ok = s->y4m ? writeY4M(*s, *f) : writePNG(*s, *f);
+
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (ok) ++s->stats.written;
+        else ++s->stats.dropped;
+        s->freeFrames.push_back(f);
+    }
+}
+
+//----------------------------------------------------------
+//  READBACK (GL thread)
+//----------------------------------------------------------
+static void makeDirectory(const std::string& path)
+{
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+static void stopEncoders(FrameCaptureState& s)
+{
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.stopping = true;
+    }
+    s.wake.notify_all();
+    for (auto& t : s.encoders) t.join();
+    s.encoders.clear();
+}
+
+// maps a slot whose readback was issued a ring's worth of frames ago and queues it
+static void collectSlot(FrameCaptureState& s, ReadbackSlot& slot)
+{
+    slot.pending = false;
+    bool stalled = glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED;
+    if (stalled) glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    CaptureFrame* f = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        ++s.stats.captured;
+        if (stalled) ++s.stats.stalls;
+        if (s.freeFrames.empty() && s.frames.size() < s.maxQueued) {
+            s.frames.emplace_back(new CaptureFrame());
+            s.freeFrames.push_back(s.frames.back().get());
+        }
+        if (s.freeFrames.empty()) {
+            ++s.stats.dropped; // encoders are behind: skip rather than stall the render loop
+            return;
+        }
+        f = s.freeFrames.back();
+        s.freeFrames.pop_back();
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+    if (pixels) {
+        f->index = slot.index;
+        f->width = slot.width;
+        f->height = slot.height;
+        f->rgba.assign(pixels, pixels + slot.size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (!pixels) {
+        ++s.stats.dropped;
+        s.freeFrames.push_back(f);
+        return;
+    }
+    s.work.push_back(f);
+    s.wake.notify_one();
+}
+
+//----------------------------------------------------------
+//  FrameCapture
+//----------------------------------------------------------
+FrameCapture::FrameCapture() : mState(new FrameCaptureState()) {}
+
+FrameCapture::~FrameCapture()
+{
+    // GL objects need the context, which may be gone by now: finish() frees those
+    stopEncoders(*mState);
+    if (mState->video) fclose(mState->video);
+}
+
+bool FrameCapture::start(const char* path, int fps, bool realTime, int ringSize, int maxQueued, int threads)
+{
+    FrameCaptureState& s = *mState;
+    if (s.active) finish();
+
+    s.path = path;
+    s.fps = std::max(1, fps);
+    s.y4m = s.path.size() > 4 && s.path.compare(s.path.size() - 4, 4, ".y4m") == 0;
+    s.realTime = realTime && s.y4m;
+    s.clockStarted = false;
+    s.maxQueued = (size_t)std::max(1, maxQueued);
+    s.stats = FrameCaptureStats();
+    s.stopping = false;
+    s.nextSlot = 0;
+    s.nextIndex = 0;
+    s.videoW = s.videoH = 0;
+    s.videoFrames = 0;
+    s.lastYUV.clear();
+
+    if (s.y4m) {
+        s.video = fopen(path, "wb");
+        if (!s.video) {
+            std::cerr << "Could not open capture file " << path << "\n";
+            return false;
+        }
+    }
+    else {
+        makeDirectory(s.path);
+    }
+
+    s.ring.assign((size_t)std::max(1, ringSize), ReadbackSlot());
+    for (ReadbackSlot& slot : s.ring) glGenBuffers(1, &slot.pbo);
+
+    // the video stream has to stay in order, PNG frames are independent files
+    int encoderCount = 1;
+    if (!s.y4m) {
+        encoderCount = threads > 0 ? threads : (int)std::thread::hardware_concurrency() - 1;
+        encoderCount = std::max(1, std::min(encoderCount, 4));
+    }
+    for (int i = 0; i < encoderCount; ++i) s.encoders.emplace_back(encoderLoop, &s);
+
+    s.active = true;
+    std::cout << "Capturing " << (s.y4m ? "video" : "PNG frames") << " to " << path
+        << (s.realTime ? " (paced to wall clock)" : "") << "\n";
+    return true;
+}
+
+void FrameCapture::capture(unsigned readFbo, int width, int height)
+{
+    FrameCaptureState& s = *mState;
+    if (!s.active || width <= 0 || height <= 0) return;
+
+    // position on the fixed-rate timeline; the first frame of each tick wins
+    uint64_t index = s.nextIndex;
+    if (s.realTime) {
+        auto now = std::chrono::steady_clock::now();
+        if (!s.clockStarted) {
+            s.clockStarted = true;
+            s.clockStart = now;
+        }
+        index = (uint64_t)(std::chrono::duration<double>(now - s.clockStart).count() * s.fps);
+        if (index < s.nextIndex) return;
+    }
+
+    ReadbackSlot& slot = s.ring[s.nextSlot];
+    if (slot.pending) collectSlot(s, slot);
+
+    size_t bytes = (size_t)width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.size != bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_READ);
+        slot.size = bytes;
+    }
+
+    // readback into the bound PBO returns immediately, the copy happens on the GPU timeline
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+    glReadBuffer(readFbo == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.index = index;
+    s.nextIndex = index + 1;
+    slot.pending = true;
+    s.nextSlot = (s.nextSlot + 1) % s.ring.size();
+}
+
+void FrameCapture::finish()
+{
+    FrameCaptureState& s = *mState;
+    if (!s.active) return;
+
+    // oldest first so the video stays in order
+    for (size_t i = 0; i < s.ring.size(); ++i) {
+        ReadbackSlot& slot = s.ring[(s.nextSlot + i) % s.ring.size()];
+        if (slot.pending) collectSlot(s, slot);
+    }
+    stopEncoders(s);
+
+    for (ReadbackSlot& slot : s.ring)
+        if (slot.pbo) glDeleteBuffers(1, &slot.pbo);
+    s.ring.clear();
+    if (s.video) {
+        fclose(s.video);
+        s.video = nullptr;
+    }
+    s.active = false;
+
+    std::cout << "Capture " << s.path << ": " << s.stats.captured << " frames read back, "
+        << s.stats.written << " written, " << s.stats.dropped << " dropped, "
+        << s.stats.stalls << " readback stalls";
+    if (s.realTime) std::cout << ", " << s.stats.repeated << " repeated to keep time";
+    std::cout << "\n";
+}
+
+bool FrameCapture::active() const
+{
+    return mState->active;
+}
+
+FrameCaptureStats FrameCapture::stats() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->stats;
+}
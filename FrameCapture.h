@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+//----------------------------------------------------------
+//  FRAME CAPTURE (PBO readback ring)
+//----------------------------------------------------------
+// Reads each finished frame into one of a ring of pixel-pack buffers
+// and maps it a few frames later, once its fence has signalled, so the
+// GPU never has to drain for glReadPixels. Mapped frames are copied
+// into a fixed pool of CPU buffers and encoded on worker threads:
+//   <dir>            PNG sequence <dir>/frame_00000.png, ...
+//   <file>.y4m       raw I420 video (YUV4MPEG2, BT.601), one writer thread
+// When every pool buffer is still queued for encoding, the frame is
+// dropped and counted instead of blocking the render loop.
+//
+// With realTime set, video frames are placed on a fixed fps timeline by
+// wall-clock time: frames arriving faster than fps are skipped, gaps
+// (slow frames, idle periods, drops) repeat the last frame, so the file
+// plays back at the speed it was recorded. PNG sequences are never
+// resampled, one file per captured frame.
+//
+// Needs a current GL 3.3 context for everything but construction.
+
+struct FrameCaptureState;
+
+struct FrameCaptureStats {
+    uint64_t captured = 0; // frames read back from the GPU
+    uint64_t written = 0;  // frames encoded to disk
+    uint64_t dropped = 0;  // frames skipped because the encode queue was full
+    uint64_t stalls = 0;   // times a readback wasn't ready after a full trip round the ring
+    uint64_t repeated = 0; // video frames written again to fill time (realTime)
+};
+
+class FrameCapture {
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // realTime = pace video by wall clock (live runs) instead of one frame per capture(),
+    // ringSize = frames of latency before a readback is mapped,
+    // maxQueued = CPU frame buffers (bounds memory), threads = PNG encoders (0 = auto)
+    bool start(const char* path, int fps = 60, bool realTime = false, int ringSize = 3, int maxQueued = 8, int threads = 0);
+
+    // after the frame is drawn, before swapping: reads readFbo (0 = back buffer)
+    void capture(unsigned readFbo, int width, int height);
+
+    // maps what is still in flight, waits for the encoders and prints the counters
+    void finish();
+
+    bool active() const;
+    FrameCaptureStats stats() const;
+
+private:
+    std::unique_ptr<FrameCaptureState> mState;
+};
@@ -0,0 +1,287 @@
+//----------------------------------------------------------
+//  KERNEL BENCHMARKS (no window, no GL)
+//----------------------------------------------------------
+// Times the scene's CPU kernels in isolation, on the shipped assets and
+// on synthetic inputs scaled well past what the scene uses:
+//   floor/*    buildFloorPatch at growing size
+//   mesh/*     Assimp import + extraction, and extraction alone
+//   pick/*     screenPointToWorldRay + raySphereIntersect
+//   xform/*    model matrix composition + normal matrix
+//   decode/*   stb_image decode of the textures and skybox faces
+//
+// Run from the project directory so assets/ resolves:
+//   KernelBench [--filter <substring>] [--min-ms <ms per kernel>]
+// Outside Visual Studio it needs only glm, assimp and stb:
+//   g++ -O2 -std=c++14 KernelBench.cpp SceneKernels.cpp -lassimp -o kernelbench
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "SceneKernels.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static const char* gFilter = nullptr;
+static double gMinMs = 200.0;
+static volatile double gSink = 0.0; // results feed this so the optimiser can't drop the work
+
+//----------------------------------------------------------
+//  RUNNER
+//----------------------------------------------------------
+// Calls op in doubling batches until one batch takes at least gMinMs and
+// reports that batch. items / bytes are per call of op.
+static void runBench(const std::string& name, double items, const char* unit, double bytes,
+    const std::function<void()>& op)
+{
+    if (gFilter && name.find(gFilter) == std::string::npos) return;
+
+    op(); // warm caches and allocators
+
+    typedef std::chrono::steady_clock Clock;
+    long long calls = 1;
+    double ms = 0.0;
+    for (;;) {
+        auto t0 = Clock::now();
+        for (long long i = 0; i < calls; ++i) op();
+        ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        if (ms >= gMinMs || calls >= (1LL << 30)) break;
+        calls *= 2;
+    }
+
+    double msPerCall = ms / (double)calls;
+    double perSecond = items * 1000.0 / msPerCall;
+    char rate[32];
+    if (perSecond >= 1e9) snprintf(rate, sizeof(rate), "%.2f G%s/s", perSecond / 1e9, unit);
+    else if (perSecond >= 1e6) snprintf(rate, sizeof(rate), "%.2f M%s/s", perSecond / 1e6, unit);
+    else snprintf(rate, sizeof(rate), "%.2f k%s/s", perSecond / 1e3, unit);
+
+    printf("%-34s %12.4f ms %18s", name.c_str(), msPerCall, rate);
+    if (bytes > 0.0) printf(" %10.1f MB/s", bytes / (1024.0 * 1024.0) * 1000.0 / msPerCall);
+    printf("\n");
+    fflush(stdout);
+}
+
+static bool readFileBytes(const char* path, std::vector<unsigned char>& out)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !out.empty();
+}
+
+static size_t vertexCount(const std::vector<ModelMeshCPU>& meshes)
+{
+    size_t n = 0;
+    for (const auto& m : meshes) n += m.verts.size();
+    return n;
+}
+
+//----------------------------------------------------------
+//  FLOOR PATCH
+//----------------------------------------------------------
+static void benchFloor()
+{
+    const int sizes[] = { 32, 128, 512 }; // 32 is the software backend's floor
+    for (int halfCells : sizes) {
+        double side = 2.0 * halfCells + 1.0;
+        runBench("floor/buildFloorPatch/half=" + std::to_string(halfCells), side * side, "vert",
+            side * side * sizeof(ModelVertex) + (side - 1.0) * (side - 1.0) * 6.0 * sizeof(unsigned int), [halfCells] {
+                std::vector<ModelVertex> verts;
+                std::vector<unsigned int> indices;
+                buildFloorPatch(halfCells, 2.0f, glm::vec2(3.5f, -7.25f), 0.0f, 0.25f, verts, indices);
+                gSink = gSink + verts[verts.size() / 2].uv.x + (double)indices.size();
+            });
+    }
+}
+
+//----------------------------------------------------------
+//  MESH EXTRACTION
+//----------------------------------------------------------
+// n x n vertex heightfield as OBJ text, (n-1)^2 * 2 triangles
+static std::string syntheticObj(int n)
+{
+    std::string obj;
+    obj.reserve((size_t)n * n * 96);
+    char line[96];
+    for (int z = 0; z < n; ++z) {
+        for (int x = 0; x < n; ++x) {
+            float fx = (float)x / (n - 1), fz = (float)z / (n - 1);
+            snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\n", fx, 0.1f * std::sin(fx * 20.0f) * std::cos(fz * 20.0f), fz, fx, fz);
+            obj += line;
+        }
+    }
+    for (int z = 0; z + 1 < n; ++z) {
+        for (int x = 0; x + 1 < n; ++x) {
+            int a = z * n + x + 1, b = a + 1, c = a + n, d = c + 1; // OBJ indices start at 1
+            snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d\nf %d/%d %d/%d %d/%d\n", a, a, c, c, b, b, b, b, c, c, d, d);
+            obj += line;
+        }
+    }
+    return obj;
+}
+
+static const unsigned kImportFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs;
+
+static void benchMeshScene(const std::string& label, const aiScene* scene, const std::function<const aiScene*(Assimp::Importer&)>& import)
+{
+    std::vector<ModelMeshCPU> probe;
+    glm::vec3 bmin(1e9f), bmax(-1e9f);
+    extractModelMeshes(scene, probe, bmin, bmax);
+    double verts = (double)vertexCount(probe);
+    double bytes = verts * sizeof(ModelVertex);
+
+    runBench("mesh/extract/" + label, verts, "vert", bytes, [scene] {
+        std::vector<ModelMeshCPU> meshes;
+        glm::vec3 lo(1e9f), hi(-1e9f);
+        extractModelMeshes(scene, meshes, lo, hi);
+        gSink = gSink + lo.x + (double)meshes.size();
+    });
+
+    runBench("mesh/import+extract/" + label, verts, "vert", bytes, [&import] {
+        Assimp::Importer importer;
+        const aiScene* s = import(importer);
+        std::vector<ModelMeshCPU> meshes;
+        glm::vec3 lo(1e9f), hi(-1e9f);
+        if (s) extractModelMeshes(s, meshes, lo, hi);
+        gSink = gSink + hi.y;
+    });
+}
+
+static void benchMeshes()
+{
+    const char* swordPath = "assets/models/myModel/sword.obj";
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(swordPath, kImportFlags);
+        if (scene && scene->mRootNode) {
+            benchMeshScene("sword", scene, [swordPath](Assimp::Importer& imp) { return imp.ReadFile(swordPath, kImportFlags); });
+        }
+        else {
+            fprintf(stderr, "Could not import %s (run from the project directory)\n", swordPath);
+        }
+    }
+
+    const int sizes[] = { 64, 256, 512 };
+    for (int n : sizes) {
+        std::string obj = syntheticObj(n);
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFileFromMemory(obj.data(), obj.size(), kImportFlags, "obj");
+        if (!scene) continue;
+        benchMeshScene("grid" + std::to_string(n) + "x" + std::to_string(n), scene, [&obj](Assimp::Importer& imp) {
+            return imp.ReadFileFromMemory(obj.data(), obj.size(), kImportFlags, "obj");
+        });
+    }
+}
+
+//----------------------------------------------------------
+//  PICKING / TRANSFORMS
+//----------------------------------------------------------
+static const int kBatch = 4096; // calls per timed op, spread over varying inputs
+
+static void benchPicking()
+{
+    const int w = 800, h = 600;
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)w / (float)h, 0.1f, 500.0f);
+    glm::vec3 camPos(0.0f, 6.0f, 12.0f);
+    glm::mat4 view = glm::lookAt(camPos, camPos + glm::vec3(0.0f, -0.34f, -0.94f), glm::vec3(0, 1, 0));
+
+    runBench("pick/ray+sphere", kBatch, "pick", 0.0, [&] {
+        int hits = 0;
+        for (int i = 0; i < kBatch; ++i) {
+            float mx = (float)((i * 37) % w), my = (float)((i * 53) % h);
+            glm::vec3 dir = screenPointToWorldRay(mx, my, w, h, projection, view);
+            hits += raySphereIntersect(camPos, dir, glm::vec3(0.0f, 0.05f, 0.0f), 3.0f) ? 1 : 0;
+        }
+        gSink = gSink + hits;
+    });
+}
+
+static void benchTransforms()
+{
+    runBench("xform/model+normal", kBatch, "mat", 0.0, [] {
+        float acc = 0.0f;
+        for (int i = 0; i < kBatch; ++i) {
+            glm::mat4 model = composeModelMatrix(glm::vec3((float)(i & 15), 0.05f, (float)(i >> 4 & 15)), (float)i, 1.0f + (float)(i & 7) * 0.1f);
+            glm::mat3 normal = normalMatrixOf(model);
+            acc += model[3][0] + normal[1][1];
+        }
+        gSink = gSink + acc;
+    });
+}
+
+//----------------------------------------------------------
+//  IMAGE DECODE
+//----------------------------------------------------------
+static void benchDecode()
+{
+    const char* assets[] = {
+        "assets/textures/floor.jpg",
+        "assets/textures/sword.png",
+        "assets/skybox/right.png",
+        "assets/skybox/left.png",
+        "assets/skybox/top.png",
+        "assets/skybox/bottom.png",
+        "assets/skybox/front.png",
+        "assets/skybox/back.png",
+    };
+
+    for (const char* path : assets) {
+        std::vector<unsigned char> file;
+        if (!readFileBytes(path, file)) {
+            fprintf(stderr, "Could not read %s (run from the project directory)\n", path);
+            continue;
+        }
+
+        int w = 0, h = 0, channels = 0;
+        if (!stbi_info_from_memory(file.data(), (int)file.size(), &w, &h, &channels)) continue;
+
+        const char* name = strrchr(path, '/');
+        runBench(std::string("decode/") + (name ? name + 1 : path), (double)w * h, "pix", (double)w * h * channels, [&file] {
+            int iw, ih, ic;
+            unsigned char* data = stbi_load_from_memory(file.data(), (int)file.size(), &iw, &ih, &ic, 0);
+            if (data) gSink = gSink + data[0];
+            stbi_image_free(data);
+        });
+    }
+}
+
+//==============================================================
+//  MAIN
+//==============================================================
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--filter" && hasValue) gFilter = argv[++i];
+        else if (arg == "--min-ms" && hasValue) gMinMs = std::max(1.0, atof(argv[++i]));
+        else fprintf(stderr, "Unknown or incomplete argument: %s\n", arg.c_str());
+    }
+
+    printf("%-34s %15s %18s %15s\n", "kernel", "time / call", "throughput", "bytes");
+    benchFloor();
+    benchMeshes();
+    benchPicking();
+    benchTransforms();
+    benchDecode();
+
+    printf("(checksum %g)\n", (double)gSink);
+    return 0;
+}
@@ -0,0 +1,323 @@
+#include "LightBaker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+//----------------------------------------------------------
+//  BVH
+//----------------------------------------------------------
+// Flattened binary BVH: an interior node's children are stored at
+// leftFirst and leftFirst + 1, a leaf covers tris[leftFirst .. +count).
+struct BVHNode {
+    glm::vec3 bmin;
+    uint32_t leftFirst;
+    glm::vec3 bmax;
+    uint32_t count;
+};
+
+struct BVH {
+    std::vector<BVHNode> nodes;
+    std::vector<BakeTriangle> tris;
+};
+
+static const uint32_t kLeafSize = 4;
+static const int kTraversalStack = 64;
+
+static void growBounds(glm::vec3& bmin, glm::vec3& bmax, const BakeTriangle& t)
+{
+    bmin = glm::min(bmin, glm::min(t.v0, glm::min(t.v1, t.v2)));
+    bmax = glm::max(bmax, glm::max(t.v0, glm::max(t.v1, t.v2)));
+}
+
+static glm::vec3 centroid(const BakeTriangle& t)
+{
+    return (t.v0 + t.v1 + t.v2) * (1.0f / 3.0f);
+}
+
+static void buildNode(BVH& bvh, uint32_t nodeIndex, uint32_t first, uint32_t count)
+{
+    glm::vec3 bmin(1e30f), bmax(-1e30f);
+    glm::vec3 cmin(1e30f), cmax(-1e30f);
+    for (uint32_t i = first; i < first + count; ++i) {
+        growBounds(bmin, bmax, bvh.tris[i]);
+        glm::vec3 c = centroid(bvh.tris[i]);
+        cmin = glm::min(cmin, c);
+        cmax = glm::max(cmax, c);
+    }
+
+    bvh.nodes[nodeIndex].bmin = bmin;
+    bvh.nodes[nodeIndex].bmax = bmax;
+
+    glm::vec3 extent = cmax - cmin;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    if (count <= kLeafSize || extent[axis] <= 0.0f) {
+        bvh.nodes[nodeIndex].leftFirst = first;
+        bvh.nodes[nodeIndex].count = count;
+        return;
+    }
+
+    // median split on the widest centroid axis
+    uint32_t mid = first + count / 2;
+    std::nth_element(bvh.tris.begin() + first, bvh.tris.begin() + mid, bvh.tris.begin() + first + count,
+        [axis](const BakeTriangle& a, const BakeTriangle& b) { return centroid(a)[axis] < centroid(b)[axis]; });
+
+    uint32_t left = (uint32_t)bvh.nodes.size();
+    bvh.nodes.push_back(BVHNode());
+    bvh.nodes.push_back(BVHNode());
+    bvh.nodes[nodeIndex].leftFirst = left;
+    bvh.nodes[nodeIndex].count = 0;
+
+    buildNode(bvh, left, first, mid - first);
+    buildNode(bvh, left + 1, mid, first + count - mid);
+}
+
+static void buildBVH(BVH& bvh, const std::vector<BakeTriangle>& tris)
+{
+    bvh.tris = tris;
+    bvh.nodes.clear();
+    if (tris.empty()) return;
+
+    bvh.nodes.reserve(tris.size() * 2);
+    bvh.nodes.push_back(BVHNode());
+    buildNode(bvh, 0, 0, (uint32_t)tris.size());
+}
+
+static bool rayHitsBox(const glm::vec3& o, const glm::vec3& invDir, float tmax, const glm::vec3& bmin, const glm::vec3& bmax)
+{
+    float tx0 = (bmin.x - o.x) * invDir.x, tx1 = (bmax.x - o.x) * invDir.x;
+    float ty0 = (bmin.y - o.y) * invDir.y, ty1 = (bmax.y - o.y) * invDir.y;
+    float tz0 = (bmin.z - o.z) * invDir.z, tz1 = (bmax.z - o.z) * invDir.z;
+
+    float tnear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::min(tz0, tz1));
+    float tfar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+    return tnear <= tfar && tfar > 0.0f && tnear < tmax;
+}
+
+// Moller-Trumbore, two-sided
+static bool rayHitsTriangle(const glm::vec3& o, const glm::vec3& d, float tmax, const BakeTriangle& t)
+{
+    glm::vec3 e1 = t.v1 - t.v0;
+    glm::vec3 e2 = t.v2 - t.v0;
+    glm::vec3 p = glm::cross(d, e2);
+    float det = glm::dot(e1, p);
+    if (std::fabs(det) < 1e-12f) return false;
+
+    float inv = 1.0f / det;
+    glm::vec3 s = o - t.v0;
+    float u = glm::dot(s, p) * inv;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(d, q) * inv;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    float dist = glm::dot(e2, q) * inv;
+    return dist > 0.0f && dist < tmax;
+}
+
+// any-hit query, all AO needs
+static bool occluded(const BVH& bvh, const glm::vec3& o, const glm::vec3& d, float tmax)
+{
+    if (bvh.nodes.empty()) return false;
+
+    glm::vec3 invDir(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+    uint32_t stack[kTraversalStack];
+    int sp = 0;
+    stack[sp++] = 0;
+
+    while (sp > 0) {
+        const BVHNode& n = bvh.nodes[stack[--sp]];
+        if (!rayHitsBox(o, invDir, tmax, n.bmin, n.bmax)) continue;
+
+        if (n.count > 0) {
+            for (uint32_t i = n.leftFirst; i < n.leftFirst + n.count; ++i)
+                if (rayHitsTriangle(o, d, tmax, bvh.tris[i])) return true;
+        }
+        else if (sp + 2 <= kTraversalStack) {
+            stack[sp++] = n.leftFirst;
+            stack[sp++] = n.leftFirst + 1;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------
+//  SAMPLING
+//----------------------------------------------------------
+// per-sample hash RNG so results don't depend on thread scheduling
+static uint32_t hashU32(uint32_t x)
+{
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+static float toUnitFloat(uint32_t x)
+{
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+static void buildBasis(const glm::vec3& n, glm::vec3& t, glm::vec3& b)
+{
+    glm::vec3 up = std::fabs(n.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    t = glm::normalize(glm::cross(up, n));
+    b = glm::cross(n, t);
+}
+
+static float sampleVisibility(const BVH& bvh, const glm::vec3& p, const glm::vec3& n,
+    uint32_t sampleIndex, const BakeSettings& s)
+{
+    glm::vec3 t, b;
+    buildBasis(n, t, b);
+
+    // push the origin off the surface relative to the occlusion range
+    glm::vec3 origin = p + n * (s.maxDistance * 1e-3f);
+
+    // stratified cosine-weighted hemisphere
+    int strata = std::max(1, (int)std::sqrt((float)s.raysPerSample));
+    int rays = strata * strata;
+    int open = 0;
+
+    for (int i = 0; i < rays; ++i) {
+        uint32_t h = hashU32(sampleIndex * 9781u + (uint32_t)i * 6271u + 0x9e3779b9u);
+        float u1 = ((float)(i % strata) + toUnitFloat(h)) / (float)strata;
+        float u2 = ((float)(i / strata) + toUnitFloat(hashU32(h))) / (float)strata;
+
+        float r = std::sqrt(u1);
+        float phi = 6.28318530718f * u2;
+        glm::vec3 dir = t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(std::max(0.0f, 1.0f - u1));
+
+        if (!occluded(bvh, origin, dir, s.maxDistance)) ++open;
+    }
+    return (float)open / (float)rays;
+}
+
+//----------------------------------------------------------
+//  BAKE
+//----------------------------------------------------------
+void bakeAmbientOcclusion(const std::vector<BakeTriangle>& occluders,
+    const std::vector<glm::vec3>& points,
+    const std::vector<glm::vec3>& normals,
+    const BakeSettings& settings,
+    std::vector<float>& outAO)
+{
+    outAO.assign(points.size(), 1.0f);
+    if (points.empty()) return;
+
+    BVH bvh;
+    buildBVH(bvh, occluders);
+
+    int threadCount = settings.threads > 0 ? settings.threads : (int)std::thread::hardware_concurrency();
+    threadCount = std::max(1, threadCount);
+
+    // small chunks pulled from a shared counter keep all cores busy to the end
+    const size_t chunk = 64;
+    std::atomic<size_t> nextChunk(0);
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t begin = nextChunk.fetch_add(chunk);
+            if (begin >= points.size()) break;
+            size_t end = std::min(points.size(), begin + chunk);
+            for (size_t i = begin; i < end; ++i)
+                outAO[i] = sampleVisibility(bvh, points[i], glm::normalize(normals[i]), (uint32_t)i, settings);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threadCount; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
+
+//----------------------------------------------------------
+//  CACHE
+//----------------------------------------------------------
+static const uint32_t kBakeCacheMagic = 0x454b4142; // "BAKE"
+static const uint32_t kBakeVersion = 2;             // bump when the sampling or the hashed inputs change
+
+static void fnv1a(uint64_t& h, const void* data, size_t bytes)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+}
+
+uint64_t hashBakeInputs(const std::vector<BakeTriangle>& occluders,
+    const std::vector<glm::vec3>& points,
+    const std::vector<glm::vec3>& normals,
+    const BakeSettings& settings)
+{
+    uint64_t h = 14695981039346656037ULL;
+    fnv1a(h, &kBakeVersion, sizeof(kBakeVersion));
+    fnv1a(h, &settings.raysPerSample, sizeof(settings.raysPerSample));
+    fnv1a(h, &settings.maxDistance, sizeof(settings.maxDistance));
+    if (!occluders.empty()) fnv1a(h, occluders.data(), occluders.size() * sizeof(BakeTriangle));
+    if (!points.empty()) fnv1a(h, points.data(), points.size() * sizeof(glm::vec3));
+    if (!normals.empty()) fnv1a(h, normals.data(), normals.size() * sizeof(glm::vec3));
+    return h;
+}
+
+std::string bakeCachePath(const char* name, uint64_t hash)
+{
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return std::string("cache/") + name + "_" + hex + ".bin";
+}
+
+bool loadBakeCache(const std::string& path, uint64_t hash, std::vector<float>& data)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in.is_open()) return false;
+
+    uint32_t magic = 0;
+    uint64_t fileHash = 0;
+    uint64_t count = 0;
+    in.read((char*)&magic, sizeof(magic));
+    in.read((char*)&fileHash, sizeof(fileHash));
+    in.read((char*)&count, sizeof(count));
+    if (!in || magic != kBakeCacheMagic || fileHash != hash) return false;
+
+    data.resize((size_t)count);
+    in.read((char*)data.data(), count * sizeof(float));
+    return (bool)in;
+}
+
+bool saveBakeCache(const std::string& path, uint64_t hash, const std::vector<float>& data)
+{
+#ifdef _WIN32
+    _mkdir("cache");
+#else
+    mkdir("cache", 0755);
+#endif
+
+    std::ofstream out(path.c_str(), std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write bake cache: " << path << "\n";
+        return false;
+    }
+
+    uint64_t count = data.size();
+    out.write((const char*)&kBakeCacheMagic, sizeof(kBakeCacheMagic));
+    out.write((const char*)&hash, sizeof(hash));
+    out.write((const char*)&count, sizeof(count));
+    out.write((const char*)data.data(), data.size() * sizeof(float));
+    return (bool)out;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------
+//  CPU AMBIENT-OCCLUSION BAKER
+//----------------------------------------------------------
+// Traces cosine-weighted hemisphere rays against a BVH of the static
+// triangles and stores the unoccluded fraction per sample point.
+// Sample points are either mesh vertices (per-vertex AO) or lightmap
+// texel centres. Results are deterministic for a given input so
+// they can be cached on disk.
+
+struct BakeTriangle {
+    glm::vec3 v0, v1, v2;
+};
+
+struct BakeSettings {
+    int raysPerSample = 64;
+    float maxDistance = 4.0f; // occluders further away than this don't count
+    int threads = 0;          // 0 = std::thread::hardware_concurrency()
+};
+
+// outAO[i] = visibility (1 = open sky) of points[i] along normals[i]
+void bakeAmbientOcclusion(const std::vector<BakeTriangle>& occluders,
+    const std::vector<glm::vec3>& points,
+    const std::vector<glm::vec3>& normals,
+    const BakeSettings& settings,
+    std::vector<float>& outAO);
+
+// FNV-1a over everything that affects a bake result
+uint64_t hashBakeInputs(const std::vector<BakeTriangle>& occluders,
+    const std::vector<glm::vec3>& points,
+    const std::vector<glm::vec3>& normals,
+    const BakeSettings& settings);
+
+// cache/<name>_<hash>.bin, invalidated by hash mismatch
+std::string bakeCachePath(const char* name, uint64_t hash);
+bool loadBakeCache(const std::string& path, uint64_t hash, std::vector<float>& data);
+bool saveBakeCache(const std::string& path, uint64_t hash, const std::vector<float>& data);
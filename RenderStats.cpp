@@ -0,0 +1,297 @@
+#include "RenderStats.h"
+
+#ifdef RENDER_STATS
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+//----------------------------------------------------------
+//  COUNTERS
+//----------------------------------------------------------
+struct RenderPassStats {
+    const char* name = nullptr;
+    uint64_t frame[RS_COUNTER_COUNT] = {};
+    uint64_t total[RS_COUNTER_COUNT] = {};
+};
+
+static const char* kCounterNames[RS_COUNTER_COUNT] = {
+    "draws", "triangles", "programs", "vaos", "textures", "redundant", "uniforms", "buffer_bytes", "dispatches"
+};
+
+static std::vector<RenderPassStats> gPasses; // [0] = work issued before the first pass marker
+static size_t gCurrentPass = 0;
+static uint64_t gFrameCount = 0;
+
+static FILE* gCsv = nullptr;
+static bool gPrintToStdout = false;
+static std::chrono::steady_clock::time_point gLastPrint;
+
+// what the wrappers last bound, to spot binds that change nothing.
+// Objects deleted while bound are not tracked; the next bind just counts as a change.
+static const int kTrackedUnits = 32;
+static GLuint gBoundProgram = 0;
+static GLuint gBoundVAO = 0;
+static int gActiveUnit = 0;
+static GLuint gBoundTextures[kTrackedUnits][3] = {}; // 2D, 2D_ARRAY, CUBE_MAP
+
+static void ensureOtherPass()
+{
+    if (gPasses.empty()) {
+        gPasses.emplace_back();
+        gPasses[0].name = "other";
+    }
+}
+
+static void bump(RenderStatCounter c, uint64_t n = 1)
+{
+    ensureOtherPass();
+    gPasses[gCurrentPass].frame[c] += n;
+}
+
+static uint64_t trianglesOf(GLenum mode, GLsizei count)
+{
+    switch (mode) {
+    case GL_TRIANGLES: return (uint64_t)(count / 3);
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN: return count > 2 ? (uint64_t)(count - 2) : 0;
+    default: return 0; // points / lines
+    }
+}
+
+static int textureTargetSlot(GLenum target)
+{
+    switch (target) {
+    case GL_TEXTURE_2D: return 0;
+    case GL_TEXTURE_2D_ARRAY: return 1;
+    case GL_TEXTURE_CUBE_MAP: return 2;
+    default: return -1;
+    }
+}
+
+//----------------------------------------------------------
+//  FRAME / REPORTING
+//----------------------------------------------------------
+bool renderStatsOpen(const char* path)
+{
+    if (std::strcmp(path, "-") == 0) {
+        gPrintToStdout = true;
+        gLastPrint = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    gCsv = std::fopen(path, "w");
+    if (!gCsv) {
+        std::cerr << "Could not write render stats " << path << "\n";
+        return false;
+    }
+    std::fprintf(gCsv, "frame,pass");
+    for (int c = 0; c < RS_COUNTER_COUNT; ++c) std::fprintf(gCsv, ",%s", kCounterNames[c]);
+    std::fprintf(gCsv, "\n");
+    return true;
+}
+
+static void printRow(const char* name, const uint64_t* values, double scale)
+{
+    std::printf("  %-16s", name);
+    for (int c = 0; c < RS_COUNTER_COUNT; ++c) std::printf(" %12.1f", (double)values[c] * scale);
+    std::printf("\n");
+}
+
+static void printHeader()
+{
+    std::printf("  %-16s", "pass");
+    for (int c = 0; c < RS_COUNTER_COUNT; ++c) std::printf(" %12s", kCounterNames[c]);
+    std::printf("\n");
+}
+
+void renderStatsClose()
+{
+    if (gCsv) {
+        std::fclose(gCsv);
+        gCsv = nullptr;
+    }
+    if (gFrameCount == 0) return;
+
+    uint64_t sum[RS_COUNTER_COUNT] = {};
+    std::printf("Render stats, per-frame average over %llu frames:\n", (unsigned long long)gFrameCount);
+    printHeader();
+    for (const RenderPassStats& p : gPasses) {
+        printRow(p.name, p.total, 1.0 / (double)gFrameCount);
+        for (int c = 0; c < RS_COUNTER_COUNT; ++c) sum[c] += p.total[c];
+    }
+    printRow("frame", sum, 1.0 / (double)gFrameCount);
+}
+
+void renderStatsBeginFrame()
+{
+    for (RenderPassStats& p : gPasses)
+        std::memset(p.frame, 0, sizeof(p.frame));
+    gCurrentPass = 0;
+}
+
+void renderStatsPass(const char* name)
+{
+    for (size_t i = 0; i < gPasses.size(); ++i) {
+        if (std::strcmp(gPasses[i].name, name) == 0) {
+            gCurrentPass = i;
+            return;
+        }
+    }
+    ensureOtherPass();
+    gPasses.emplace_back();
+    gPasses.back().name = name;
+    gCurrentPass = gPasses.size() - 1;
+}
+
+void renderStatsEndFrame()
+{
+    ++gFrameCount;
+    uint64_t sum[RS_COUNTER_COUNT] = {};
+    for (RenderPassStats& p : gPasses) {
+        for (int c = 0; c < RS_COUNTER_COUNT; ++c) {
+            p.total[c] += p.frame[c];
+            sum[c] += p.frame[c];
+        }
+        if (gCsv) {
+            std::fprintf(gCsv, "%llu,%s", (unsigned long long)gFrameCount, p.name);
+            for (int c = 0; c < RS_COUNTER_COUNT; ++c) std::fprintf(gCsv, ",%llu", (unsigned long long)p.frame[c]);
+            std::fprintf(gCsv, "\n");
+        }
+    }
+    if (gCsv) {
+        std::fprintf(gCsv, "%llu,frame", (unsigned long long)gFrameCount);
+        for (int c = 0; c < RS_COUNTER_COUNT; ++c) std::fprintf(gCsv, ",%llu", (unsigned long long)sum[c]);
+        std::fprintf(gCsv, "\n");
+    }
+
+    if (gPrintToStdout) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - gLastPrint >= std::chrono::seconds(1)) {
+            gLastPrint = now;
+            std::printf("Render stats, frame %llu:\n", (unsigned long long)gFrameCount);
+            printHeader();
+            for (const RenderPassStats& p : gPasses) printRow(p.name, p.frame, 1.0);
+            printRow("frame", sum, 1.0);
+        }
+    }
+}
+
+//----------------------------------------------------------
+//  GL WRAPPERS
+//----------------------------------------------------------
+void renderStatsDispatch()
+{
+    bump(RS_DISPATCHES);
+}
+
+void renderStatsIndirectDraw()
+{
+    bump(RS_DRAW_CALLS);
+}
+
+void rsDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    bump(RS_DRAW_CALLS);
+    bump(RS_TRIANGLES, trianglesOf(mode, count));
+    glad_glDrawArrays(mode, first, count);
+}
+
+void rsDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    bump(RS_DRAW_CALLS);
+    bump(RS_TRIANGLES, trianglesOf(mode, count));
+    glad_glDrawElements(mode, count, type, indices);
+}
+
+void rsDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+{
+    bump(RS_DRAW_CALLS);
+    bump(RS_TRIANGLES, trianglesOf(mode, count) * (uint64_t)instancecount);
+    glad_glDrawArraysInstanced(mode, first, count, instancecount);
+}
+
+void rsDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount)
+{
+    bump(RS_DRAW_CALLS);
+    bump(RS_TRIANGLES, trianglesOf(mode, count) * (uint64_t)instancecount);
+    glad_glDrawElementsInstanced(mode, count, type, indices, instancecount);
+}
+
+void rsUseProgram(GLuint program)
+{
+    bump(RS_PROGRAM_BINDS);
+    if (program == gBoundProgram) bump(RS_REDUNDANT_BINDS);
+    gBoundProgram = program;
+    glad_glUseProgram(program);
+}
+
+void rsBindVertexArray(GLuint array)
+{
+    bump(RS_VAO_BINDS);
+    if (array == gBoundVAO) bump(RS_REDUNDANT_BINDS);
+    gBoundVAO = array;
+    glad_glBindVertexArray(array);
+}
+
+void rsActiveTexture(GLenum texture)
+{
+    gActiveUnit = (int)(texture - GL_TEXTURE0);
+    glad_glActiveTexture(texture);
+}
+
+void rsBindTexture(GLenum target, GLuint texture)
+{
+    bump(RS_TEXTURE_BINDS);
+    int slot = textureTargetSlot(target);
+    if (slot >= 0 && gActiveUnit >= 0 && gActiveUnit < kTrackedUnits) {
+        if (gBoundTextures[gActiveUnit][slot] == texture) bump(RS_REDUNDANT_BINDS);
+        gBoundTextures[gActiveUnit][slot] = texture;
+    }
+    glad_glBindTexture(target, texture);
+}
+
+void rsUniform1i(GLint location, GLint v0) { bump(RS_UNIFORM_UPLOADS); glad_glUniform1i(location, v0); }
+void rsUniform2i(GLint location, GLint v0, GLint v1) { bump(RS_UNIFORM_UPLOADS); glad_glUniform2i(location, v0, v1); }
+void rsUniform3i(GLint location, GLint v0, GLint v1, GLint v2) { bump(RS_UNIFORM_UPLOADS); glad_glUniform3i(location, v0, v1, v2); }
+void rsUniform4i(GLint location, GLint v0, GLint v1, GLint v2, GLint v3) { bump(RS_UNIFORM_UPLOADS); glad_glUniform4i(location, v0, v1, v2, v3); }
+void rsUniform1f(GLint location, GLfloat v0) { bump(RS_UNIFORM_UPLOADS); glad_glUniform1f(location, v0); }
+void rsUniform2f(GLint location, GLfloat v0, GLfloat v1) { bump(RS_UNIFORM_UPLOADS); glad_glUniform2f(location, v0, v1); }
+void rsUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) { bump(RS_UNIFORM_UPLOADS); glad_glUniform3f(location, v0, v1, v2); }
+void rsUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { bump(RS_UNIFORM_UPLOADS); glad_glUniform4f(location, v0, v1, v2, v3); }
+void rsUniform1iv(GLint location, GLsizei n, const GLint* value) { bump(RS_UNIFORM_UPLOADS); glad_glUniform1iv(location, n, value); }
+void rsUniform2iv(GLint location, GLsizei n, const GLint* value) { bump(RS_UNIFORM_UPLOADS); glad_glUniform2iv(location, n, value); }
+void rsUniform3iv(GLint location, GLsizei n, const GLint* value) { bump(RS_UNIFORM_UPLOADS); glad_glUniform3iv(location, n, value); }
+void rsUniform4iv(GLint location, GLsizei n, const GLint* value) { bump(RS_UNIFORM_UPLOADS); glad_glUniform4iv(location, n, value); }
+void rsUniform1fv(GLint location, GLsizei n, const GLfloat* value) { bump(RS_UNIFORM_UPLOADS); glad_glUniform1fv(location, n, value); }
+void rsUniform2fv(GLint location, GLsizei n, const GLfloat* value) { bump(RS_UNIFORM_UPLOADS); glad_glUniform2fv(location, n, value); }
+void rsUniform3fv(GLint location, GLsizei n, const GLfloat* value) { bump(RS_UNIFORM_UPLOADS); glad_glUniform3fv(location, n, value); }
+void rsUniform4fv(GLint location, GLsizei n, const GLfloat* value) { bump(RS_UNIFORM_UPLOADS); glad_glUniform4fv(location, n, value); }
+
+void rsUniformMatrix3fv(GLint location, GLsizei n, GLboolean transpose, const GLfloat* value)
+{
+    bump(RS_UNIFORM_UPLOADS);
+    glad_glUniformMatrix3fv(location, n, transpose, value);
+}
+
+void rsUniformMatrix4fv(GLint location, GLsizei n, GLboolean transpose, const GLfloat* value)
+{
+    bump(RS_UNIFORM_UPLOADS);
+    glad_glUniformMatrix4fv(location, n, transpose, value);
+}
+
+void rsBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    bump(RS_BUFFER_BYTES, (uint64_t)size);
+    glad_glBufferData(target, size, data, usage);
+}
+
+void rsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    bump(RS_BUFFER_BYTES, (uint64_t)size);
+    glad_glBufferSubData(target, offset, size, data);
+}
+
+#endif
@@ -0,0 +1,157 @@
+#pragma once
+
+//----------------------------------------------------------
+//  RENDER STATISTICS (build with RENDER_STATS defined)
+//----------------------------------------------------------
+// Counts the GL traffic a frame submits, split into named passes:
+// draw calls, triangles, program / VAO / texture binds (and how many
+// of those rebound what was already bound), uniform uploads, bytes
+// handed to glBufferData / glBufferSubData and compute dispatches.
+//
+// Include after glad: with RENDER_STATS the entry points below are
+// redirected to counting wrappers. Without it the hooks are empty
+// macros and every GL call goes straight to glad, so a normal build
+// pays nothing.
+//
+//   RENDER_STATS_BEGIN_FRAME();      resets the per-frame counters
+//   RENDER_STATS_PASS("scene");      later calls count against "scene"
+//   RENDER_STATS_END_FRAME();        reports the frame
+//
+// Entry points loaded outside glad (compute, multi-draw-indirect) are
+// counted at the call site with RENDER_STATS_DISPATCH() and
+// RENDER_STATS_INDIRECT_DRAW(). An indirect draw is one draw call; its
+// triangle count only exists on the GPU and is not included.
+
+#ifdef RENDER_STATS
+
+#include <glad/glad.h>
+
+enum RenderStatCounter {
+    RS_DRAW_CALLS,
+    RS_TRIANGLES,
+    RS_PROGRAM_BINDS,
+    RS_VAO_BINDS,
+    RS_TEXTURE_BINDS,
+    RS_REDUNDANT_BINDS, // program / VAO / texture bound again with no change
+    RS_UNIFORM_UPLOADS,
+    RS_BUFFER_BYTES,
+    RS_DISPATCHES,
+    RS_COUNTER_COUNT
+};
+
+// path "-" prints the last frame to stdout once a second, anything else
+// is a CSV time series (one row per pass per frame, plus a "frame" total)
+bool renderStatsOpen(const char* path);
+void renderStatsClose(); // prints per-frame averages over the run
+
+void renderStatsBeginFrame();
+void renderStatsPass(const char* name); // name must outlive the run (string literal)
+void renderStatsEndFrame();
+void renderStatsDispatch();
+void renderStatsIndirectDraw();
+
+void rsDrawArrays(GLenum mode, GLint first, GLsizei count);
+void rsDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void rsDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+void rsDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount);
+
+void rsUseProgram(GLuint program);
+void rsBindVertexArray(GLuint array);
+void rsActiveTexture(GLenum texture);
+void rsBindTexture(GLenum target, GLuint texture);
+
+void rsUniform1i(GLint location, GLint v0);
+void rsUniform2i(GLint location, GLint v0, GLint v1);
+void rsUniform3i(GLint location, GLint v0, GLint v1, GLint v2);
+void rsUniform4i(GLint location, GLint v0, GLint v1, GLint v2, GLint v3);
+void rsUniform1f(GLint location, GLfloat v0);
+void rsUniform2f(GLint location, GLfloat v0, GLfloat v1);
+void rsUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+void rsUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+void rsUniform1iv(GLint location, GLsizei count, const GLint* value);
+void rsUniform2iv(GLint location, GLsizei count, const GLint* value);
+void rsUniform3iv(GLint location, GLsizei count, const GLint* value);
+void rsUniform4iv(GLint location, GLsizei count, const GLint* value);
+void rsUniform1fv(GLint location, GLsizei count, const GLfloat* value);
+void rsUniform2fv(GLint location, GLsizei count, const GLfloat* value);
+void rsUniform3fv(GLint location, GLsizei count, const GLfloat* value);
+void rsUniform4fv(GLint location, GLsizei count, const GLfloat* value);
+void rsUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+void rsUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+
+void rsBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+void rsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+
+#undef glDrawArrays
+#undef glDrawElements
+#undef glDrawArraysInstanced
+#undef glDrawElementsInstanced
+#undef glUseProgram
+#undef glBindVertexArray
+#undef glActiveTexture
+#undef glBindTexture
+#undef glUniform1i
+#undef glUniform2i
+#undef glUniform3i
+#undef glUniform4i
+#undef glUniform1f
+#undef glUniform2f
+#undef glUniform3f
+#undef glUniform4f
+#undef glUniform1iv
+#undef glUniform2iv
+#undef glUniform3iv
+#undef glUniform4iv
+#undef glUniform1fv
+#undef glUniform2fv
+#undef glUniform3fv
+#undef glUniform4fv
+#undef glUniformMatrix3fv
+#undef glUniformMatrix4fv
+#undef glBufferData
+#undef glBufferSubData
+
+#define glDrawArrays rsDrawArrays
+#define glDrawElements rsDrawElements
+#define glDrawArraysInstanced rsDrawArraysInstanced
+#define glDrawElementsInstanced rsDrawElementsInstanced
+#define glUseProgram rsUseProgram
+#define glBindVertexArray rsBindVertexArray
+#define glActiveTexture rsActiveTexture
+#define glBindTexture rsBindTexture
+#define glUniform1i rsUniform1i
+#define glUniform2i rsUniform2i
+#define glUniform3i rsUniform3i
+#define glUniform4i rsUniform4i
+#define glUniform1f rsUniform1f
+#define glUniform2f rsUniform2f
+#define glUniform3f rsUniform3f
+#define glUniform4f rsUniform4f
+#define glUniform1iv rsUniform1iv
+#define glUniform2iv rsUniform2iv
+#define glUniform3iv rsUniform3iv
+#define glUniform4iv rsUniform4iv
+#define glUniform1fv rsUniform1fv
+#define glUniform2fv rsUniform2fv
+#define glUniform3fv rsUniform3fv
+#define glUniform4fv rsUniform4fv
+#define glUniformMatrix3fv rsUniformMatrix3fv
+#define glUniformMatrix4fv rsUniformMatrix4fv
+#define glBufferData rsBufferData
+#define glBufferSubData rsBufferSubData
+
+#define RENDER_STATS_BEGIN_FRAME() renderStatsBeginFrame()
+#define RENDER_STATS_PASS(name) renderStatsPass(name)
+#define RENDER_STATS_END_FRAME() renderStatsEndFrame()
+#define RENDER_STATS_DISPATCH() renderStatsDispatch()
+#define RENDER_STATS_INDIRECT_DRAW() renderStatsIndirectDraw()
+
+#else
+
+#define RENDER_STATS_BEGIN_FRAME() ((void)0)
+#define RENDER_STATS_PASS(name) ((void)0)
+#define RENDER_STATS_END_FRAME() ((void)0)
+#define RENDER_STATS_DISPATCH() ((void)0)
+#define RENDER_STATS_INDIRECT_DRAW() ((void)0)
+
+#endif
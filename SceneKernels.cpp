@@ -0,0 +1,162 @@
+#include "SceneKernels.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+
+//----------------------------------------------------------
+//  FLOOR PATCH
+//----------------------------------------------------------
+void buildFloorPatch(int halfCells, float cellSize, const glm::vec2& center, float y, float uvPerUnit,
+    std::vector<ModelVertex>& verts, std::vector<unsigned int>& indices)
+{
+    int side = 2 * halfCells + 1; // vertices per row
+    float originX = std::floor(center.x / cellSize + 0.5f) * cellSize - halfCells * cellSize;
+    float originZ = std::floor(center.y / cellSize + 0.5f) * cellSize - halfCells * cellSize;
+
+    verts.clear();
+    indices.clear();
+    verts.reserve((size_t)side * side);
+    indices.reserve((size_t)(side - 1) * (side - 1) * 6);
+
+    for (int iz = 0; iz < side; ++iz) {
+        for (int ix = 0; ix < side; ++ix) {
+            ModelVertex v;
+            v.pos = glm::vec3(originX + ix * cellSize, y, originZ + iz * cellSize);
+            v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            v.uv = glm::vec2(v.pos.x, v.pos.z) * uvPerUnit;
+            verts.push_back(v);
+        }
+    }
+
+    // same winding as the old non-indexed grid: (x0,z0) (x1,z0) (x1,z1), (x0,z0) (x1,z1) (x0,z1)
+    for (int iz = 0; iz + 1 < side; ++iz) {
+        for (int ix = 0; ix + 1 < side; ++ix) {
+            unsigned int a = (unsigned int)(iz * side + ix), b = a + 1;
+            unsigned int c = a + (unsigned int)side, d = c + 1;
+            indices.push_back(a); indices.push_back(b); indices.push_back(d);
+            indices.push_back(a); indices.push_back(d); indices.push_back(c);
+        }
+    }
+}
+
+//----------------------------------------------------------
+//  MESH EXTRACTION (Assimp)
+//----------------------------------------------------------
+void extractModelMeshes(const aiScene* scene, std::vector<ModelMeshCPU>& out, glm::vec3& minV, glm::vec3& maxV)
+{
+    for (unsigned int mi = 0; mi < scene->mNumMeshes; ++mi) {
+        const aiMesh* mesh = scene->mMeshes[mi];
+
+        std::vector<ModelVertex> verts;
+        std::vector<unsigned int> indices;
+        verts.reserve(mesh->mNumVertices);
+
+        for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+            ModelVertex v{};
+
+            v.pos = glm::vec3(mesh->mVertices[i].x,
+                mesh->mVertices[i].y,
+                mesh->mVertices[i].z);
+
+            minV = glm::min(minV, v.pos);
+            maxV = glm::max(maxV, v.pos);
+
+            if (mesh->HasNormals())
+                v.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            else
+                v.normal = glm::vec3(0, 1, 0);
+
+            if (mesh->mTextureCoords[0])
+                v.uv = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+            else
+                v.uv = glm::vec2(0, 0);
+
+            verts.push_back(v);
+        }
+
+        for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+            const aiFace& face = mesh->mFaces[f];
+            for (unsigned int j = 0; j < face.mNumIndices; ++j)
+                indices.push_back(face.mIndices[j]);
+        }
+
+        ModelMeshCPU cpu;
+        cpu.verts.swap(verts);
+        cpu.indices.swap(indices);
+        out.push_back(cpu);
+    }
+}
+
+bool loadModelMeshes(const std::string& path, std::vector<ModelMeshCPU>& out, glm::vec3& bmin, glm::vec3& bmax)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(
+        path,
+        aiProcess_Triangulate |
+        aiProcess_GenSmoothNormals |
+        aiProcess_FlipUVs
+    );
+
+    if (!scene || !scene->mRootNode) {
+        std::cerr << "Assimp failed: " << importer.GetErrorString() << "\n";
+        return false;
+    }
+
+    extractModelMeshes(scene, out, bmin, bmax);
+    return true;
+}
+
+//----------------------------------------------------------
+//  PICKING
+//----------------------------------------------------------
+glm::vec3 screenPointToWorldRay(float mx, float my, int w, int h, const glm::mat4& projection, const glm::mat4& view)
+{
+    // Normalized Device Coordinates (-1..1)
+    float x = (2.0f * mx) / (float)w - 1.0f;
+    float y = 1.0f - (2.0f * my) / (float)h; // flip Y
+    glm::vec4 rayClip(x, y, -1.0f, 1.0f);
+
+    // Eye space
+    glm::vec4 rayEye = glm::inverse(projection) * rayClip;
+    rayEye = glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f);
+
+    // World space
+    glm::vec3 rayWorld = glm::normalize(glm::vec3(glm::inverse(view) * rayEye));
+    return rayWorld;
+}
+
+bool raySphereIntersect(
+    const glm::vec3& rayOrigin,
+    const glm::vec3& rayDir,
+    const glm::vec3& sphereCenter,
+    float sphereRadius
+) {
+    glm::vec3 oc = rayOrigin - sphereCenter;
+    float b = glm::dot(oc, rayDir);
+    float c = glm::dot(oc, oc) - sphereRadius * sphereRadius;
+    float h = b * b - c;
+    return h >= 0.0f;
+}
+
+//----------------------------------------------------------
+//  TRANSFORMS
+//----------------------------------------------------------
+glm::mat4 composeModelMatrix(const glm::vec3& pos, float yawDegrees, float scale)
+{
+    glm::mat4 m(1.0f);
+    m = glm::translate(m, pos);
+    m = glm::rotate(m, glm::radians(yawDegrees), glm::vec3(0, 1, 0));
+    m = glm::scale(m, glm::vec3(scale));
+    return m;
+}
+
+glm::mat3 normalMatrixOf(const glm::mat4& model)
+{
+    return glm::transpose(glm::inverse(glm::mat3(model)));
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+struct aiScene;
+
+//----------------------------------------------------------
+//  SCENE KERNELS (CPU only, no GL / window)
+//----------------------------------------------------------
+// The load-time and per-frame CPU work of the scene, kept free of GL and
+// GLFW so the app and KernelBench run the same code.
+
+struct ModelVertex {
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+// CPU copy kept for baking
+struct ModelMeshCPU {
+    std::vector<ModelVertex> verts;
+    std::vector<unsigned int> indices;
+    int material = -1; // material index, -1 = untextured
+};
+
+// indexed square floor patch of (2 * halfCells)^2 cells around the grid
+// point nearest center (xz), so it can follow the camera. Normal +Y, UVs are
+// world xz * uvPerUnit and stay continuous as the patch moves.
+void buildFloorPatch(int halfCells, float cellSize, const glm::vec2& center, float y, float uvPerUnit,
+    std::vector<ModelVertex>& verts, std::vector<unsigned int>& indices);
+
+// flattens every mesh of an imported scene; bmin / bmax grow to the vertex bounds
+void extractModelMeshes(const aiScene* scene, std::vector<ModelMeshCPU>& out, glm::vec3& bmin, glm::vec3& bmax);
+
+// Assimp import (triangulate, smooth normals, flip UVs) + extractModelMeshes
+bool loadModelMeshes(const std::string& path, std::vector<ModelMeshCPU>& out, glm::vec3& bmin, glm::vec3& bmax);
+
+// world-space direction through window pixel (mx, my) of a w x h window
+glm::vec3 screenPointToWorldRay(float mx, float my, int w, int h, const glm::mat4& projection, const glm::mat4& view);
+bool raySphereIntersect(const glm::vec3& rayOrigin, const glm::vec3& rayDir, const glm::vec3& sphereCenter, float sphereRadius);
+
+// translate * rotateY(yawDegrees) * scale, the sword's transform
+glm::mat4 composeModelMatrix(const glm::vec3& pos, float yawDegrees, float scale);
+glm::mat3 normalMatrixOf(const glm::mat4& model);
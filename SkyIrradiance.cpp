@@ -0,0 +1,270 @@
+#include "SkyIrradiance.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SKY_SH_SSE 1
+#endif
+
+//----------------------------------------------------------
+//  PROJECTION
+//----------------------------------------------------------
+// Unnormalised direction of texel (s, t) in [-1, 1]^2 is major + s * sAxis + t * tAxis,
+// per the GL cubemap face table (same as the software backend's sampler).
+struct FaceAxes {
+    glm::vec3 major, sAxis, tAxis;
+};
+
+static const FaceAxes kFaceAxes[6] = {
+    { glm::vec3( 1, 0, 0), glm::vec3( 0, 0, -1), glm::vec3(0, -1,  0) }, // +X
+    { glm::vec3(-1, 0, 0), glm::vec3( 0, 0,  1), glm::vec3(0, -1,  0) }, // -X
+    { glm::vec3( 0, 1, 0), glm::vec3( 1, 0,  0), glm::vec3(0,  0,  1) }, // +Y
+    { glm::vec3( 0,-1, 0), glm::vec3( 1, 0,  0), glm::vec3(0,  0, -1) }, // -Y
+    { glm::vec3( 0, 0, 1), glm::vec3( 1, 0,  0), glm::vec3(0, -1,  0) }, // +Z
+    { glm::vec3( 0, 0,-1), glm::vec3(-1, 0,  0), glm::vec3(0, -1,  0) }, // -Z
+};
+
+// basis order: 1, y, z, x, xy, yz, 3z^2 - 1, xz, x^2 - y^2
+static const float kBasisScale[9] = {
+    0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f
+};
+// cosine lobe convolution / pi per band (Ramamoorthi & Hanrahan)
+static const float kBandCosine[9] = {
+    1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f
+};
+
+// one row's contribution: sum over texels of colour * weight * basis polynomial
+struct RowSums {
+    double rgb[9][3];
+    double weight;
+};
+
+static void accumulateTexel(RowSums& sum, const glm::vec3& dirUnnorm, float weightScale, const glm::vec3& c)
+{
+    float invLen = 1.0f / std::sqrt(glm::dot(dirUnnorm, dirUnnorm));
+    glm::vec3 d = dirUnnorm * invLen;
+    float w = weightScale * invLen * invLen * invLen; // texel solid angle
+
+    float basis[9] = {
+        1.0f, d.y, d.z, d.x, d.x * d.y, d.y * d.z, 3.0f * d.z * d.z - 1.0f, d.x * d.z, d.x * d.x - d.y * d.y
+    };
+    for (int i = 0; i < 9; ++i) {
+        sum.rgb[i][0] += (double)(c.x * w * basis[i]);
+        sum.rgb[i][1] += (double)(c.y * w * basis[i]);
+        sum.rgb[i][2] += (double)(c.z * w * basis[i]);
+    }
+    sum.weight += (double)w;
+}
+
+// rgb: planar rows of the face converted to [0, 1] floats
+static void projectRow(RowSums& sum, const FaceAxes& axes, int width, float t, float weightScale,
+    const float* r, const float* g, const float* b)
+{
+    glm::vec3 rowBase = axes.major + t * axes.tAxis;
+    float ds = 2.0f / (float)width;
+    int x = 0;
+
+#ifdef SKY_SH_SSE
+    // 4 texels per step; float lanes are flushed into the double row sums once per row
+    __m128 acc[9][3];
+    for (int i = 0; i < 9; ++i)
+        for (int c = 0; c < 3; ++c) acc[i][c] = _mm_setzero_ps();
+    __m128 accW = _mm_setzero_ps();
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 three = _mm_set1_ps(3.0f);
+    const __m128 wScale = _mm_set1_ps(weightScale);
+    const __m128 baseX = _mm_set1_ps(rowBase.x), baseY = _mm_set1_ps(rowBase.y), baseZ = _mm_set1_ps(rowBase.z);
+    const __m128 sx = _mm_set1_ps(axes.sAxis.x), sy = _mm_set1_ps(axes.sAxis.y), sz = _mm_set1_ps(axes.sAxis.z);
+    const __m128 laneS = _mm_set_ps(3.5f * ds - 1.0f, 2.5f * ds - 1.0f, 1.5f * ds - 1.0f, 0.5f * ds - 1.0f);
+    const __m128 stepS = _mm_set1_ps(4.0f * ds);
+    __m128 s = laneS;
+
+    for (; x + 4 <= width; x += 4, s = _mm_add_ps(s, stepS)) {
+        __m128 dx = _mm_add_ps(baseX, _mm_mul_ps(s, sx));
+        __m128 dy = _mm_add_ps(baseY, _mm_mul_ps(s, sy));
+        __m128 dz = _mm_add_ps(baseZ, _mm_mul_ps(s, sz));
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 invLen = _mm_div_ps(one, _mm_sqrt_ps(len2));
+        dx = _mm_mul_ps(dx, invLen);
+        dy = _mm_mul_ps(dy, invLen);
+        dz = _mm_mul_ps(dz, invLen);
+        __m128 w = _mm_mul_ps(wScale, _mm_mul_ps(invLen, _mm_mul_ps(invLen, invLen)));
+        accW = _mm_add_ps(accW, w);
+
+        __m128 col[3] = {
+            _mm_mul_ps(_mm_loadu_ps(r + x), w),
+            _mm_mul_ps(_mm_loadu_ps(g + x), w),
+            _mm_mul_ps(_mm_loadu_ps(b + x), w),
+        };
+        __m128 basis[9] = {
+            one, dy, dz, dx,
+            _mm_mul_ps(dx, dy),
+            _mm_mul_ps(dy, dz),
+            _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(dz, dz)), one),
+            _mm_mul_ps(dx, dz),
+            _mm_sub_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+        };
+        for (int i = 0; i < 9; ++i)
+            for (int c = 0; c < 3; ++c)
+                acc[i][c] = _mm_add_ps(acc[i][c], _mm_mul_ps(col[c], basis[i]));
+    }
+
+    float lanes[4];
+    for (int i = 0; i < 9; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            _mm_storeu_ps(lanes, acc[i][c]);
+            sum.rgb[i][c] += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+    }
+    _mm_storeu_ps(lanes, accW);
+    sum.weight += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; x < width; ++x) {
+        float sCoord = ((float)x + 0.5f) * ds - 1.0f;
+        accumulateTexel(sum, rowBase + sCoord * axes.sAxis, weightScale, glm::vec3(r[x], g[x], b[x]));
+    }
+}
+
+// Band-2 SH can't resolve detail finer than a few degrees, so large faces
+// are box-filtered down to at most this many texels per side before projecting.
+static const int kMaxProjectSize = 128;
+
+static int projectedSize(int size)
+{
+    return std::min(size, kMaxProjectSize);
+}
+
+bool projectSkyIrradiance(const SkyFace faces[6], int threads, glm::vec3 outSH[9])
+{
+    for (int i = 0; i < 9; ++i) outSH[i] = glm::vec3(0.0f);
+
+    // one work item per (filtered) row of every present face
+    struct RowRef { int face, y; };
+    std::vector<RowRef> rows;
+    int facesPresent = 0;
+    for (int f = 0; f < 6; ++f) {
+        if (!faces[f].pixels || faces[f].width <= 0 || faces[f].height <= 0) continue;
+        ++facesPresent;
+        for (int y = 0; y < projectedSize(faces[f].height); ++y) rows.push_back({ f, y });
+    }
+    if (rows.empty()) return false;
+
+    std::vector<RowSums> sums(rows.size());
+
+    int threadCount = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+    threadCount = std::max(1, std::min(threadCount, (int)rows.size()));
+
+    const size_t chunk = 8;
+    std::atomic<size_t> nextChunk(0);
+
+    auto worker = [&]() {
+        std::vector<float> r, g, b;
+        for (;;) {
+            size_t begin = nextChunk.fetch_add(chunk);
+            if (begin >= rows.size()) break;
+            size_t end = std::min(rows.size(), begin + chunk);
+            for (size_t i = begin; i < end; ++i) {
+                const SkyFace& face = faces[rows[i].face];
+                int w = face.width, h = face.height, ch = face.channels;
+                int pw = projectedSize(w), ph = projectedSize(h);
+                int y = rows[i].y;
+                r.assign(pw, 0.0f); g.assign(pw, 0.0f); b.assign(pw, 0.0f);
+
+                // box filter: output texel (x, y) averages source [x*w/pw, (x+1)*w/pw) x [y*h/ph, (y+1)*h/ph)
+                int y0 = (int)((int64_t)y * h / ph), y1 = (int)((int64_t)(y + 1) * h / ph);
+                for (int x = 0; x < pw; ++x) {
+                    int x0 = (int)((int64_t)x * w / pw), x1 = (int)((int64_t)(x + 1) * w / pw);
+                    unsigned sr = 0, sg = 0, sb = 0;
+                    for (int sy = y0; sy < y1; ++sy) {
+                        const unsigned char* src = face.pixels + ((size_t)sy * w + x0) * ch;
+                        for (int sx = x0; sx < x1; ++sx, src += ch) {
+                            sr += src[0];
+                            sg += src[ch >= 3 ? 1 : 0];
+                            sb += src[ch >= 3 ? 2 : 0];
+                        }
+                    }
+                    float scale = 1.0f / (255.0f * (float)((x1 - x0) * (y1 - y0)));
+                    r[x] = sr * scale;
+                    g[x] = sg * scale;
+                    b[x] = sb * scale;
+                }
+
+                RowSums& sum = sums[i];
+                sum = RowSums();
+                float t = ((float)y + 0.5f) * (2.0f / (float)ph) - 1.0f;
+                float weightScale = 4.0f / ((float)pw * (float)ph);
+                projectRow(sum, kFaceAxes[rows[i].face], pw, t, weightScale, r.data(), g.data(), b.data());
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threadCount; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+
+    RowSums total = RowSums();
+    for (const RowSums& s : sums) {
+        for (int i = 0; i < 9; ++i)
+            for (int c = 0; c < 3; ++c) total.rgb[i][c] += s.rgb[i][c];
+        total.weight += s.weight;
+    }
+
+    // the texel solid angles only approximate 4pi/6 per face, so renormalise
+    const double kPi = 3.14159265358979323846;
+    double norm = (4.0 * kPi / 6.0) * facesPresent / total.weight;
+    for (int i = 0; i < 9; ++i) {
+        double k = (double)kBasisScale[i] * kBasisScale[i] * kBandCosine[i] * norm;
+        outSH[i] = glm::vec3((float)(total.rgb[i][0] * k), (float)(total.rgb[i][1] * k), (float)(total.rgb[i][2] * k));
+    }
+    return true;
+}
+
+glm::vec3 evalSkyIrradiance(const glm::vec3 sh[9], const glm::vec3& n)
+{
+    return sh[0]
+        + sh[1] * n.y + sh[2] * n.z + sh[3] * n.x
+        + sh[4] * (n.x * n.y) + sh[5] * (n.y * n.z) + sh[6] * (3.0f * n.z * n.z - 1.0f)
+        + sh[7] * (n.x * n.z) + sh[8] * (n.x * n.x - n.y * n.y);
+}
+
+//----------------------------------------------------------
+//  HASH
+//----------------------------------------------------------
+// FNV-1a over 64-bit words: the faces are a few MB, byte-wise FNV would
+// cost as much as the projection it is meant to skip
+static const uint32_t kSkyProjectVersion = 1; // bump when the projection changes
+
+uint64_t hashSkyFaces(const SkyFace faces[6])
+{
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t h = 14695981039346656037ULL;
+    h = (h ^ kSkyProjectVersion) * prime;
+    for (int f = 0; f < 6; ++f) {
+        const SkyFace& face = faces[f];
+        h = (h ^ (uint64_t)(uint32_t)face.width) * prime;
+        h = (h ^ (uint64_t)(uint32_t)face.height) * prime;
+        h = (h ^ (uint64_t)(uint32_t)face.channels) * prime;
+        if (!face.pixels) continue;
+
+        size_t bytes = (size_t)face.width * face.height * face.channels;
+        size_t words = bytes / 8;
+        const unsigned char* p = face.pixels;
+        for (size_t i = 0; i < words; ++i, p += 8) {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+            h = (h ^ v) * prime;
+        }
+        for (size_t i = words * 8; i < bytes; ++i)
+            h = (h ^ face.pixels[i]) * prime;
+    }
+    return h;
+}
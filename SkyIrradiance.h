@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+//----------------------------------------------------------
+//  SKY IRRADIANCE (spherical harmonics)
+//----------------------------------------------------------
+// Projects the six skybox faces onto the first nine real spherical
+// harmonics (bands 0-2) and convolves them with the cosine lobe, which
+// is all a diffuse ambient term needs. Faces are box-filtered to at most
+// 128x128 first; rows are spread over threads and each row is integrated
+// 4 texels at a time with SSE (scalar fallback).
+// Every row is summed on its own and the rows are added in order, so the
+// result doesn't depend on thread scheduling.
+
+struct SkyFace {
+    const unsigned char* pixels = nullptr; // rows top first, as uploaded to GL; null = missing
+    int width = 0, height = 0, channels = 0; // channels = 1, 3 or 4 (as returned by stb_image)
+};
+
+// faces in cubemap order +X, -X, +Y, -Y, +Z, -Z. outSH is irradiance / pi
+// with the basis constants folded in, evaluated for a unit normal n as
+//   c0 + c1 y + c2 z + c3 x + c4 xy + c5 yz + c6 (3z^2 - 1) + c7 xz + c8 (x^2 - y^2)
+// Returns false if no face had pixels.
+bool projectSkyIrradiance(const SkyFace faces[6], int threads, glm::vec3 outSH[9]);
+
+glm::vec3 evalSkyIrradiance(const glm::vec3 sh[9], const glm::vec3& n);
+
+// FNV-1a over the face sizes and pixels, for the on-disk cache
+uint64_t hashSkyFaces(const SkyFace faces[6]);
@@ -0,0 +1,727 @@
+#include "SoftRasterizer.h"
+#include "SkyIrradiance.h"
+#include "SoftRasterizerAVX2.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#if SOFT_HAVE_AVX2_KERNEL && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h> // _xgetbv
+#endif
+
+//----------------------------------------------------------
+//  WORK-STEALING POOL
+//----------------------------------------------------------
+// parallelFor() deals items out to per-thread queues in contiguous
+// blocks (neighbouring tiles tend to share triangles), each thread pops
+// from the back of its own queue and steals from the front of the
+// others once it runs dry. The calling thread works too.
+// parallelFor() only returns once every worker has left drain(), so no
+// worker can still be popping when the next call refills the queues.
+class SoftThreadPool {
+public:
+    explicit SoftThreadPool(int threads);
+    ~SoftThreadPool();
+
+    void parallelFor(int count, const std::function<void(int)>& fn);
+
+private:
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<int> items;
+    };
+
+    void workerLoop(int self);
+    bool popOrSteal(int self, int& item);
+    void drain(int self, const std::function<void(int)>& fn);
+
+    std::vector<std::thread> mWorkers;
+    std::vector<std::unique_ptr<WorkerQueue>> mQueues; // last one belongs to the caller
+
+    std::mutex mLock;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    const std::function<void(int)>* mJob = nullptr;
+    std::atomic<int> mRemaining{ 0 };
+    int mActive = 0; // workers inside drain(), guarded by mLock
+    uint64_t mGeneration = 0;
+    bool mQuit = false;
+};
+
+SoftThreadPool::SoftThreadPool(int threads)
+{
+    int count = std::max(1, threads);
+    for (int i = 0; i < count; ++i) mQueues.emplace_back(new WorkerQueue());
+    for (int i = 0; i < count - 1; ++i) mWorkers.emplace_back(&SoftThreadPool::workerLoop, this, i);
+}
+
+SoftThreadPool::~SoftThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lk(mLock);
+        mQuit = true;
+    }
+    mWake.notify_all();
+    for (auto& t : mWorkers) t.join();
+}
+
+bool SoftThreadPool::popOrSteal(int self, int& item)
+{
+    {
+        WorkerQueue& own = *mQueues[self];
+        std::lock_guard<std::mutex> lk(own.lock);
+        if (!own.items.empty()) {
+            item = own.items.back();
+            own.items.pop_back();
+            return true;
+        }
+    }
+
+    int n = (int)mQueues.size();
+    for (int i = 1; i < n; ++i) {
+        WorkerQueue& victim = *mQueues[(self + i) % n];
+        std::lock_guard<std::mutex> lk(victim.lock);
+        if (!victim.items.empty()) {
+            item = victim.items.front();
+            victim.items.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void SoftThreadPool::drain(int self, const std::function<void(int)>& fn)
+{
+    int item;
+    while (popOrSteal(self, item)) {
+        fn(item);
+        if (mRemaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lk(mLock);
+            mDone.notify_all();
+        }
+    }
+}
+
+void SoftThreadPool::workerLoop(int self)
+{
+    uint64_t seen = 0;
+    for (;;) {
+        const std::function<void(int)>* job;
+        {
+            std::unique_lock<std::mutex> lk(mLock);
+            mWake.wait(lk, [&] { return mQuit || mGeneration != seen; });
+            if (mQuit) return;
+            seen = mGeneration;
+            job = mJob;
+            if (!job) continue; // woke after that call already finished
+            ++mActive;
+        }
+        drain(self, *job);
+        {
+            std::lock_guard<std::mutex> lk(mLock);
+            --mActive;
+        }
+        mDone.notify_all();
+    }
+}
+
+void SoftThreadPool::parallelFor(int count, const std::function<void(int)>& fn)
+{
+    if (count <= 0) return;
+
+    int n = (int)mQueues.size();
+    if (n == 1 || count == 1) {
+        for (int i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    for (int q = 0; q < n; ++q) {
+        int begin = (int)((long long)count * q / n);
+        int end = (int)((long long)count * (q + 1) / n);
+        std::lock_guard<std::mutex> lk(mQueues[q]->lock);
+        for (int i = begin; i < end; ++i) mQueues[q]->items.push_back(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(mLock);
+        mJob = &fn;
+        mRemaining = count;
+        ++mGeneration;
+    }
+    mWake.notify_all();
+
+    drain(n - 1, fn);
+
+    std::unique_lock<std::mutex> lk(mLock);
+    mDone.wait(lk, [&] { return mRemaining.load() == 0 && mActive == 0; });
+    mJob = nullptr;
+}
+
+//----------------------------------------------------------
+//  FRAME DATA
+//----------------------------------------------------------
+static const int kTileSize = 64;
+static const int kAttribs = 12; // world xyz, normal xyz, color rgb, uv, ao
+static const uint32_t kNoTriangle = 0xffffffffu;
+static const int kVertexChunk = 1024;
+static const int kTriangleChunk = 512;
+
+struct ClipVertex {
+    glm::vec4 clip;
+    float attr[kAttribs];
+};
+
+// Barycentric planes over window coordinates: lambda_i(x, y) =
+// ex[i] * x + ey[i] * y + ec[i], already divided by the signed area
+// so both windings come out positive inside (GL has culling off here).
+struct SetupTri : SoftEdgePlanes {
+    float invW[3];
+    float attrW[3][kAttribs]; // attribute / w for perspective-correct interpolation
+    int minX, minY, maxX, maxY;
+    uint32_t draw;
+};
+
+struct SoftFrameScratch {
+    std::vector<std::vector<ClipVertex>> transformed; // per draw
+    std::vector<std::vector<SetupTri>> chunkTris;     // per setup job
+    std::vector<SetupTri> tris;
+    std::vector<std::vector<uint32_t>> bins;          // triangle indices per tile
+    int tilesX = 0, tilesY = 0;
+    bool avx2 = false; // CPU can run softRasterizeTileAVX2
+};
+
+// AVX2 needs both the instructions and the OS saving ymm state (XGETBV)
+static bool cpuHasAVX2()
+{
+#if SOFT_HAVE_AVX2_KERNEL && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const int osxsave = 1 << 27, avx = 1 << 28;
+    if ((info[2] & (osxsave | avx)) != (osxsave | avx)) return false;
+    if ((_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif SOFT_HAVE_AVX2_KERNEL
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+//----------------------------------------------------------
+//  TEXTURES
+//----------------------------------------------------------
+static uint32_t packRGBA(float r, float g, float b, float a)
+{
+    auto q = [](float v) { return (uint32_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    return q(r) | (q(g) << 8) | (q(b) << 16) | (q(a) << 24);
+}
+
+static glm::vec4 unpackRGBA(uint32_t p)
+{
+    const float k = 1.0f / 255.0f;
+    return glm::vec4((float)(p & 0xff) * k, (float)((p >> 8) & 0xff) * k,
+        (float)((p >> 16) & 0xff) * k, (float)(p >> 24) * k);
+}
+
+static void fillLevel(SoftTexture::Level& level, const unsigned char* pixels, int width, int height, int channels)
+{
+    level.width = width;
+    level.height = height;
+    level.texels.resize((size_t)width * height);
+
+    for (int i = 0; i < width * height; ++i) {
+        const unsigned char* p = pixels + (size_t)i * channels;
+        uint32_t r = p[0];
+        uint32_t g = channels >= 3 ? p[1] : 0;
+        uint32_t b = channels >= 3 ? p[2] : 0;
+        uint32_t a = channels == 4 ? p[3] : 255;
+        if (channels == 2) { g = 0; a = 255; }
+        level.texels[i] = r | (g << 8) | (b << 16) | (a << 24);
+    }
+}
+
+void softBuildTexture(SoftTexture& tex, const unsigned char* pixels, int width, int height, int channels)
+{
+    tex.levels.clear();
+    tex.levels.emplace_back();
+    fillLevel(tex.levels.back(), pixels, width, height, channels);
+
+    // box-filtered chain down to 1x1, like glGenerateMipmap
+    while (tex.levels.back().width > 1 || tex.levels.back().height > 1) {
+        const SoftTexture::Level& src = tex.levels.back();
+        SoftTexture::Level dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = std::max(1, src.height / 2);
+        dst.texels.resize((size_t)dst.width * dst.height);
+
+        for (int y = 0; y < dst.height; ++y) {
+            for (int x = 0; x < dst.width; ++x) {
+                int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+                int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+                glm::vec4 c = unpackRGBA(src.texels[y0 * src.width + x0]) + unpackRGBA(src.texels[y0 * src.width + x1])
+                    + unpackRGBA(src.texels[y1 * src.width + x0]) + unpackRGBA(src.texels[y1 * src.width + x1]);
+                c = c * 0.25f;
+                dst.texels[y * dst.width + x] = packRGBA(c.x, c.y, c.z, c.w);
+            }
+        }
+        tex.levels.push_back(std::move(dst));
+    }
+}
+
+void softBuildCubemapFace(SoftCubemap& cube, int face, const unsigned char* pixels, int width, int height, int channels)
+{
+    if (face < 0 || face >= 6) return;
+    fillLevel(cube.faces[face], pixels, width, height, channels);
+}
+
+static glm::vec4 sampleBilinear(const SoftTexture::Level& l, float u, float v, bool repeat)
+{
+    float fx = u * (float)l.width - 0.5f;
+    float fy = v * (float)l.height - 0.5f;
+    float flx = std::floor(fx), fly = std::floor(fy);
+    float tx = fx - flx, ty = fy - fly;
+    int x0 = (int)flx, y0 = (int)fly;
+    int x1 = x0 + 1, y1 = y0 + 1;
+
+    if (repeat) {
+        auto wrap = [](int i, int n) { i %= n; return i < 0 ? i + n : i; };
+        x0 = wrap(x0, l.width); x1 = wrap(x1, l.width);
+        y0 = wrap(y0, l.height); y1 = wrap(y1, l.height);
+    }
+    else {
+        x0 = std::min(std::max(x0, 0), l.width - 1); x1 = std::min(std::max(x1, 0), l.width - 1);
+        y0 = std::min(std::max(y0, 0), l.height - 1); y1 = std::min(std::max(y1, 0), l.height - 1);
+    }
+
+    glm::vec4 a = unpackRGBA(l.texels[y0 * l.width + x0]);
+    glm::vec4 b = unpackRGBA(l.texels[y0 * l.width + x1]);
+    glm::vec4 c = unpackRGBA(l.texels[y1 * l.width + x0]);
+    glm::vec4 d = unpackRGBA(l.texels[y1 * l.width + x1]);
+    glm::vec4 top = a + (b - a) * tx;
+    glm::vec4 bottom = c + (d - c) * tx;
+    return top + (bottom - top) * ty;
+}
+
+// GL_LINEAR_MIPMAP_LINEAR with GL_REPEAT
+static glm::vec4 sampleTrilinear(const SoftTexture& tex, float u, float v, float lod)
+{
+    int maxLevel = (int)tex.levels.size() - 1;
+    lod = std::min(std::max(lod, 0.0f), (float)maxLevel);
+    int l0 = (int)lod;
+    int l1 = std::min(l0 + 1, maxLevel);
+    float t = lod - (float)l0;
+
+    glm::vec4 a = sampleBilinear(tex.levels[l0], u, v, true);
+    if (t <= 0.0f || l0 == l1) return a;
+    glm::vec4 b = sampleBilinear(tex.levels[l1], u, v, true);
+    return a + (b - a) * t;
+}
+
+// face selection per the GL cubemap table
+static glm::vec3 sampleCubemap(const SoftCubemap& cube, const glm::vec3& d)
+{
+    glm::vec3 a(std::fabs(d.x), std::fabs(d.y), std::fabs(d.z));
+    int face;
+    float sc, tc, ma;
+
+    if (a.x >= a.y && a.x >= a.z) {
+        ma = a.x;
+        if (d.x > 0.0f) { face = 0; sc = -d.z; tc = -d.y; }
+        else            { face = 1; sc = d.z;  tc = -d.y; }
+    }
+    else if (a.y >= a.z) {
+        ma = a.y;
+        if (d.y > 0.0f) { face = 2; sc = d.x; tc = d.z; }
+        else            { face = 3; sc = d.x; tc = -d.z; }
+    }
+    else {
+        ma = a.z;
+        if (d.z > 0.0f) { face = 4; sc = d.x;  tc = -d.y; }
+        else            { face = 5; sc = -d.x; tc = -d.y; }
+    }
+
+    const SoftTexture::Level& l = cube.faces[face];
+    if (l.texels.empty() || ma <= 0.0f) return glm::vec3(0.0f);
+    glm::vec4 c = sampleBilinear(l, 0.5f * (sc / ma + 1.0f), 0.5f * (tc / ma + 1.0f), false);
+    return glm::vec3(c.x, c.y, c.z);
+}
+
+//----------------------------------------------------------
+//  GEOMETRY
+//----------------------------------------------------------
+static ClipVertex lerpClip(const ClipVertex& a, const ClipVertex& b, float t)
+{
+    ClipVertex r;
+    r.clip = a.clip + (b.clip - a.clip) * t;
+    for (int i = 0; i < kAttribs; ++i) r.attr[i] = a.attr[i] + (b.attr[i] - a.attr[i]) * t;
+    return r;
+}
+
+// Sutherland-Hodgman against z >= -w; the other planes are handled by
+// the screen bounding box. Returns the vertex count (0, 3 or 4).
+static int clipNear(const ClipVertex in[3], ClipVertex out[4])
+{
+    int n = 0;
+    for (int i = 0; i < 3; ++i) {
+        const ClipVertex& a = in[i];
+        const ClipVertex& b = in[(i + 1) % 3];
+        float da = a.clip.z + a.clip.w;
+        float db = b.clip.z + b.clip.w;
+
+        if (da >= 0.0f) out[n++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f)) out[n++] = lerpClip(a, b, da / (da - db));
+    }
+    return n;
+}
+
+static bool outsideFrustum(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+{
+    for (int axis = 0; axis < 3; ++axis) {
+        if (a.clip[axis] > a.clip.w && b.clip[axis] > b.clip.w && c.clip[axis] > c.clip.w) return true;
+        if (a.clip[axis] < -a.clip.w && b.clip[axis] < -b.clip.w && c.clip[axis] < -c.clip.w) return true;
+    }
+    return false;
+}
+
+static void setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2,
+    uint32_t draw, int width, int height, std::vector<SetupTri>& out)
+{
+    const ClipVertex* v[3] = { &v0, &v1, &v2 };
+    float sx[3], sy[3], sz[3], iw[3];
+
+    for (int i = 0; i < 3; ++i) {
+        iw[i] = 1.0f / v[i]->clip.w;
+        sx[i] = (v[i]->clip.x * iw[i] * 0.5f + 0.5f) * (float)width;
+        sy[i] = (0.5f - v[i]->clip.y * iw[i] * 0.5f) * (float)height; // window y grows downwards
+        sz[i] = v[i]->clip.z * iw[i] * 0.5f + 0.5f;
+    }
+
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+    if (std::fabs(area) < 1e-8f) return;
+
+    SetupTri t;
+    t.minX = std::max(0, (int)std::floor(std::min(sx[0], std::min(sx[1], sx[2]))));
+    t.minY = std::max(0, (int)std::floor(std::min(sy[0], std::min(sy[1], sy[2]))));
+    t.maxX = std::min(width - 1, (int)std::ceil(std::max(sx[0], std::max(sx[1], sx[2]))));
+    t.maxY = std::min(height - 1, (int)std::ceil(std::max(sy[0], std::max(sy[1], sy[2]))));
+    if (t.minX > t.maxX || t.minY > t.maxY) return;
+
+    float invArea = 1.0f / area;
+    for (int i = 0; i < 3; ++i) {
+        // lambda_i uses the edge opposite vertex i
+        int a = (i + 1) % 3, b = (i + 2) % 3;
+        float dx = sx[b] - sx[a], dy = sy[b] - sy[a];
+        t.ex[i] = -dy * invArea;
+        t.ey[i] = dx * invArea;
+        t.ec[i] = (dy * sx[a] - dx * sy[a]) * invArea;
+    }
+
+    t.zx = t.ex[0] * sz[0] + t.ex[1] * sz[1] + t.ex[2] * sz[2];
+    t.zy = t.ey[0] * sz[0] + t.ey[1] * sz[1] + t.ey[2] * sz[2];
+    t.zc = t.ec[0] * sz[0] + t.ec[1] * sz[1] + t.ec[2] * sz[2];
+
+    for (int i = 0; i < 3; ++i) {
+        t.invW[i] = iw[i];
+        for (int k = 0; k < kAttribs; ++k) t.attrW[i][k] = v[i]->attr[k] * iw[i];
+    }
+    t.draw = draw;
+    out.push_back(t);
+}
+
+//----------------------------------------------------------
+//  RASTERIZATION
+//----------------------------------------------------------
+// Visibility pass for one triangle inside one tile: depth test and
+// remember which triangle owns each pixel. Shading happens afterwards.
+static void rasterizeInTile(const SetupTri& t, uint32_t triIndex, int tileX, int tileY,
+    float* depth, uint32_t* ids, bool avx2)
+{
+    int x0 = std::max(t.minX, tileX), x1 = std::min(t.maxX, tileX + kTileSize - 1);
+    int y0 = std::max(t.minY, tileY), y1 = std::min(t.maxY, tileY + kTileSize - 1);
+    if (x0 > x1 || y0 > y1) return;
+
+    if (avx2) {
+#if SOFT_HAVE_AVX2_KERNEL
+        softRasterizeTileAVX2(t, triIndex, x0, x1, y0, y1, tileX, tileY, kTileSize, depth, ids);
+#endif
+        return;
+    }
+
+    for (int y = y0; y <= y1; ++y) {
+        float py = (float)y + 0.5f;
+        for (int x = x0; x <= x1; ++x) {
+            float px = (float)x + 0.5f;
+            float l0 = t.ex[0] * px + t.ey[0] * py + t.ec[0];
+            float l1 = t.ex[1] * px + t.ey[1] * py + t.ec[1];
+            float l2 = t.ex[2] * px + t.ey[2] * py + t.ec[2];
+            if (l0 < 0.0f || l1 < 0.0f || l2 < 0.0f) continue;
+
+            int i = (y - tileY) * kTileSize + (x - tileX);
+            float z = t.zx * px + t.zy * py + t.zc;
+            if (z < depth[i]) {
+                depth[i] = z;
+                ids[i] = triIndex;
+            }
+        }
+    }
+}
+
+// perspective-correct attributes at window position (px, py)
+static void interpolate(const SetupTri& t, float px, float py, float* out, int count)
+{
+    float l0 = t.ex[0] * px + t.ey[0] * py + t.ec[0];
+    float l1 = t.ex[1] * px + t.ey[1] * py + t.ec[1];
+    float l2 = t.ex[2] * px + t.ey[2] * py + t.ec[2];
+    float w = 1.0f / (l0 * t.invW[0] + l1 * t.invW[1] + l2 * t.invW[2]);
+    for (int k = 0; k < count; ++k)
+        out[k] = (l0 * t.attrW[0][k] + l1 * t.attrW[1][k] + l2 * t.attrW[2][k]) * w;
+}
+
+//----------------------------------------------------------
+//  SHADING (mirrors fragment.glsl)
+//----------------------------------------------------------
+static glm::vec3 shadePixel(const SoftFrameParams& f, const SoftDraw& draw, const SetupTri& t, float px, float py)
+{
+    float a[kAttribs];
+    interpolate(t, px, py, a, kAttribs);
+
+    glm::vec3 worldPos(a[0], a[1], a[2]);
+    glm::vec3 N = glm::normalize(glm::vec3(a[3], a[4], a[5]));
+    glm::vec3 vColor(a[6], a[7], a[8]);
+    float u = a[9], v = a[10];
+    float ao = a[11];
+
+    glm::vec3 lightVec = f.lightPos - worldPos;
+    float dist = glm::length(lightVec);
+    glm::vec3 L = lightVec / std::max(dist, 0.0001f);
+    glm::vec3 V = glm::normalize(f.viewPos - worldPos);
+
+    float att = 1.0f / (f.constantAtt + f.linearAtt * dist + f.quadraticAtt * dist * dist);
+
+    if (draw.lightmap && !draw.lightmap->levels.empty()) {
+        glm::vec4 p = draw.lightmapFromWorld * glm::vec4(worldPos, 1.0f);
+        const glm::vec4& r = draw.lightmapRect;
+        glm::vec4 s = sampleBilinear(draw.lightmap->levels[0], (p.x - r.x) / (r.z - r.x), (p.z - r.y) / (r.w - r.y), false);
+        ao *= s.x;
+    }
+    glm::vec3 sky = glm::max(evalSkyIrradiance(f.ambientSH, N), glm::vec3(0.0f));
+    glm::vec3 ambient = f.ambientStrength * ao * sky;
+
+    float diff = std::max(glm::dot(N, L), 0.0f);
+    glm::vec3 diffuse = diff * f.lightColor;
+
+    float spec = 0.0f;
+    if (diff > 0.0f) {
+        if (f.useBlinnPhong) {
+            glm::vec3 H = glm::normalize(L + V);
+            spec = std::pow(std::max(glm::dot(N, H), 0.0f), f.shininess);
+        }
+        else {
+            glm::vec3 R = glm::reflect(-L, N);
+            spec = std::pow(std::max(glm::dot(V, R), 0.0f), f.shininess);
+        }
+    }
+    glm::vec3 specular = f.specStrength * spec * f.lightColor;
+    glm::vec3 lit = ambient + (diffuse + specular) * att;
+
+    glm::vec3 baseColor = vColor;
+    if (draw.selected) {
+        baseColor = glm::vec3(1.0f, 1.0f, 0.2f);
+    }
+    else if (draw.mesh->texture && !draw.mesh->texture->levels.empty()) {
+        // LOD from the UV footprint of the neighbouring pixels
+        const SoftTexture& tex = *draw.mesh->texture;
+        float uvx[2], uvy[2];
+        float full[kAttribs];
+        interpolate(t, px + 1.0f, py, full, 11);
+        uvx[0] = full[9]; uvx[1] = full[10];
+        interpolate(t, px, py + 1.0f, full, 11);
+        uvy[0] = full[9]; uvy[1] = full[10];
+
+        float tw = (float)tex.levels[0].width, th = (float)tex.levels[0].height;
+        float dux = (uvx[0] - u) * tw, dvx = (uvx[1] - v) * th;
+        float duy = (uvy[0] - u) * tw, dvy = (uvy[1] - v) * th;
+        float rho2 = std::max(dux * dux + dvx * dvx, duy * duy + dvy * dvy);
+        float lod = rho2 > 0.0f ? 0.5f * std::log2(rho2) : 0.0f;
+
+        glm::vec4 c = sampleTrilinear(tex, u, v, lod);
+        baseColor = glm::vec3(c.x, c.y, c.z);
+    }
+
+    return baseColor * lit;
+}
+
+//----------------------------------------------------------
+//  RENDERER
+//----------------------------------------------------------
+SoftRenderer::SoftRenderer(int width, int height, int threads)
+    : mScratch(new SoftFrameScratch())
+{
+    int count = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+    mPool.reset(new SoftThreadPool(std::max(1, count)));
+    mScratch->avx2 = cpuHasAVX2();
+    resize(width, height);
+}
+
+SoftRenderer::~SoftRenderer() = default;
+
+void SoftRenderer::resize(int width, int height)
+{
+    mWidth = std::max(1, width);
+    mHeight = std::max(1, height);
+    mColor.assign((size_t)mWidth * mHeight, 0xff000000u);
+
+    mScratch->tilesX = (mWidth + kTileSize - 1) / kTileSize;
+    mScratch->tilesY = (mHeight + kTileSize - 1) / kTileSize;
+    mScratch->bins.assign((size_t)mScratch->tilesX * mScratch->tilesY, std::vector<uint32_t>());
+}
+
+void SoftRenderer::render(const SoftFrameParams& frame, const std::vector<SoftDraw>& draws)
+{
+    SoftFrameScratch& s = *mScratch;
+    glm::mat4 viewProj = frame.projection * frame.view;
+
+    // 1) vertex stage: vertex.glsl per draw, in chunks
+    struct Range { uint32_t draw; uint32_t begin, end; };
+    std::vector<Range> jobs;
+
+    s.transformed.resize(draws.size());
+    for (uint32_t d = 0; d < draws.size(); ++d) {
+        uint32_t n = draws[d].mesh ? (uint32_t)draws[d].mesh->verts.size() : 0;
+        s.transformed[d].resize(n);
+        for (uint32_t b = 0; b < n; b += kVertexChunk) jobs.push_back({ d, b, std::min(n, b + kVertexChunk) });
+    }
+
+    mPool->parallelFor((int)jobs.size(), [&](int j) {
+        const Range& r = jobs[j];
+        const SoftDraw& draw = draws[r.draw];
+        glm::mat4 mvp = viewProj * draw.model;
+        for (uint32_t i = r.begin; i < r.end; ++i) {
+            const SoftVertex& in = draw.mesh->verts[i];
+            ClipVertex& out = s.transformed[r.draw][i];
+            glm::vec4 world = draw.model * glm::vec4(in.pos, 1.0f);
+            glm::vec3 n = draw.normalMatrix * in.normal;
+
+            out.clip = mvp * glm::vec4(in.pos, 1.0f);
+            out.attr[0] = world.x; out.attr[1] = world.y; out.attr[2] = world.z;
+            out.attr[3] = n.x; out.attr[4] = n.y; out.attr[5] = n.z;
+            out.attr[6] = in.color.x; out.attr[7] = in.color.y; out.attr[8] = in.color.z;
+            out.attr[9] = in.uv.x; out.attr[10] = in.uv.y;
+            out.attr[11] = in.ao;
+        }
+    });
+
+    // 2) clip + triangle setup, one output list per job to stay lock-free
+    jobs.clear();
+    for (uint32_t d = 0; d < draws.size(); ++d) {
+        uint32_t n = draws[d].mesh ? (uint32_t)draws[d].mesh->indices.size() / 3 : 0;
+        for (uint32_t b = 0; b < n; b += kTriangleChunk) jobs.push_back({ d, b, std::min(n, b + kTriangleChunk) });
+    }
+    s.chunkTris.resize(jobs.size());
+
+    int width = mWidth, height = mHeight;
+    mPool->parallelFor((int)jobs.size(), [&](int j) {
+        const Range& r = jobs[j];
+        const std::vector<uint32_t>& idx = draws[r.draw].mesh->indices;
+        const std::vector<ClipVertex>& tv = s.transformed[r.draw];
+        std::vector<SetupTri>& out = s.chunkTris[j];
+        out.clear();
+
+        for (uint32_t t = r.begin; t < r.end; ++t) {
+            ClipVertex in[3] = { tv[idx[t * 3]], tv[idx[t * 3 + 1]], tv[idx[t * 3 + 2]] };
+            if (outsideFrustum(in[0], in[1], in[2])) continue;
+
+            ClipVertex poly[4];
+            int n = clipNear(in, poly);
+            for (int k = 1; k + 1 < n; ++k)
+                setupTriangle(poly[0], poly[k], poly[k + 1], r.draw, width, height, out);
+        }
+    });
+
+    // 3) binning, serial so each bin keeps submission order
+    s.tris.clear();
+    for (auto& c : s.chunkTris) s.tris.insert(s.tris.end(), c.begin(), c.end());
+    for (auto& b : s.bins) b.clear();
+
+    for (uint32_t i = 0; i < s.tris.size(); ++i) {
+        const SetupTri& t = s.tris[i];
+        int tx0 = t.minX / kTileSize, tx1 = t.maxX / kTileSize;
+        int ty0 = t.minY / kTileSize, ty1 = t.maxY / kTileSize;
+        for (int ty = ty0; ty <= ty1; ++ty)
+            for (int tx = tx0; tx <= tx1; ++tx)
+                s.bins[ty * s.tilesX + tx].push_back(i);
+    }
+
+    // 4) tiles: visibility, then shade each covered pixel once, sky elsewhere
+    glm::mat4 invSky = glm::inverse(frame.projection * glm::mat4(glm::mat3(frame.view)));
+    uint32_t clear = packRGBA(frame.clearColor.x, frame.clearColor.y, frame.clearColor.z, 1.0f);
+
+    mPool->parallelFor(s.tilesX * s.tilesY, [&](int tile) {
+        int tileX = (tile % s.tilesX) * kTileSize;
+        int tileY = (tile / s.tilesX) * kTileSize;
+
+        float depth[kTileSize * kTileSize];
+        uint32_t ids[kTileSize * kTileSize];
+        std::fill(depth, depth + kTileSize * kTileSize, 1.0f);
+        std::fill(ids, ids + kTileSize * kTileSize, kNoTriangle);
+
+        for (uint32_t triIndex : s.bins[tile])
+            rasterizeInTile(s.tris[triIndex], triIndex, tileX, tileY, depth, ids, s.avx2);
+
+        int x1 = std::min(tileX + kTileSize, width);
+        int y1 = std::min(tileY + kTileSize, height);
+        for (int y = tileY; y < y1; ++y) {
+            for (int x = tileX; x < x1; ++x) {
+                uint32_t id = ids[(y - tileY) * kTileSize + (x - tileX)];
+                float px = (float)x + 0.5f, py = (float)y + 0.5f;
+                uint32_t out = clear;
+
+                if (id != kNoTriangle) {
+                    const SetupTri& t = s.tris[id];
+                    glm::vec3 c = shadePixel(frame, draws[t.draw], t, px, py);
+                    out = packRGBA(c.x, c.y, c.z, 1.0f);
+                }
+                else if (frame.skybox) {
+                    float ndcX = px / (float)width * 2.0f - 1.0f;
+                    float ndcY = 1.0f - py / (float)height * 2.0f;
+                    glm::vec4 d = invSky * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+                    glm::vec3 c = sampleCubemap(*frame.skybox, glm::vec3(d) / d.w);
+                    out = packRGBA(c.x, c.y, c.z, 1.0f);
+                }
+                mColor[(size_t)y * width + x] = out;
+            }
+        }
+    });
+}
+
+bool SoftRenderer::writePPM(const char* path) const
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+
+    fprintf(f, "P6\n%d %d\n255\n", mWidth, mHeight);
+    std::vector<unsigned char> row((size_t)mWidth * 3);
+    for (int y = 0; y < mHeight; ++y) {
+        for (int x = 0; x < mWidth; ++x) {
+            uint32_t p = mColor[(size_t)y * mWidth + x];
+            row[x * 3 + 0] = (unsigned char)(p & 0xff);
+            row[x * 3 + 1] = (unsigned char)((p >> 8) & 0xff);
+            row[x * 3 + 2] = (unsigned char)((p >> 16) & 0xff);
+        }
+        fwrite(row.data(), 1, row.size(), f);
+    }
+    fclose(f);
+    return true;
+}
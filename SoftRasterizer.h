@@ -0,0 +1,106 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//----------------------------------------------------------
+//  SOFTWARE RASTERIZER BACKEND
+//----------------------------------------------------------
+// CPU reimplementation of the GL pipeline for machines without a GPU:
+// vertex.glsl transform, fragment.glsl Phong/Blinn + attenuation with
+// baked AO, trilinear mipmapped textures and the cubemap skybox.
+//
+// Triangles are set up and binned into 64x64 tiles; tiles are then
+// rasterized in parallel on a work-stealing pool. Each tile resolves
+// visibility first (depth + triangle id) and shades every pixel once.
+// The visibility pass tests 8 pixels at a time with AVX2 when CPUID
+// reports it (SoftRasterizerAVX2.cpp), one pixel at a time otherwise.
+
+// Pixels are packed 0xAABBGGRR (RGBA8 in memory order).
+struct SoftTexture {
+    struct Level {
+        int width = 0, height = 0;
+        std::vector<uint32_t> texels;
+    };
+    std::vector<Level> levels; // level 0 = full size
+};
+
+// face order matches loadCubemap: +X, -X, +Y, -Y, +Z, -Z
+struct SoftCubemap {
+    SoftTexture::Level faces[6];
+};
+
+struct SoftVertex {
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec3 color;
+    glm::vec2 uv;
+    float ao = 1.0f;
+};
+
+struct SoftMesh {
+    std::vector<SoftVertex> verts;
+    std::vector<uint32_t> indices;
+    const SoftTexture* texture = nullptr;
+};
+
+struct SoftDraw {
+    const SoftMesh* mesh = nullptr;
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::mat3 normalMatrix = glm::mat3(1.0f);
+    bool selected = false;
+
+    // optional baked floor AO, same mapping as uLightmapFromWorld / uLightmapRect
+    const SoftTexture* lightmap = nullptr;
+    glm::mat4 lightmapFromWorld = glm::mat4(1.0f);
+    glm::vec4 lightmapRect = glm::vec4(0.0f);
+};
+
+// the uniforms the GL path sets once per frame
+struct SoftFrameParams {
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+    glm::vec3 lightPos = glm::vec3(0.0f);
+    glm::vec3 lightColor = glm::vec3(1.0f);
+    float ambientStrength = 0.18f;
+    glm::vec3 ambientSH[9] = { glm::vec3(1.0f) }; // sky irradiance, see SkyIrradiance.h
+    float specStrength = 0.5f;
+    float shininess = 32.0f;
+    float constantAtt = 1.0f;
+    float linearAtt = 0.09f;
+    float quadraticAtt = 0.032f;
+    bool useBlinnPhong = true;
+    glm::vec3 clearColor = glm::vec3(0.0f);
+    const SoftCubemap* skybox = nullptr;
+};
+
+// rgba: tightly packed rows, channels = 1, 3 or 4 (as returned by stb_image)
+void softBuildTexture(SoftTexture& tex, const unsigned char* pixels, int width, int height, int channels);
+void softBuildCubemapFace(SoftCubemap& cube, int face, const unsigned char* pixels, int width, int height, int channels);
+
+class SoftThreadPool;
+struct SoftFrameScratch;
+
+class SoftRenderer {
+public:
+    SoftRenderer(int width, int height, int threads = 0);
+    ~SoftRenderer();
+
+    void resize(int width, int height);
+    void render(const SoftFrameParams& frame, const std::vector<SoftDraw>& draws);
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    const std::vector<uint32_t>& color() const { return mColor; } // top row first
+    bool writePPM(const char* path) const;
+
+private:
+    int mWidth = 0, mHeight = 0;
+    std::vector<uint32_t> mColor;
+    std::unique_ptr<SoftThreadPool> mPool;
+    std::unique_ptr<SoftFrameScratch> mScratch;
+};
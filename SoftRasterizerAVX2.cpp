@@ -0,0 +1,60 @@
+#include "SoftRasterizerAVX2.h"
+
+#if SOFT_HAVE_AVX2_KERNEL
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SOFT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SOFT_TARGET_AVX2 // MSVC: the file is built with /arch:AVX2
+#endif
+
+SOFT_TARGET_AVX2
+void softRasterizeTileAVX2(const SoftEdgePlanes& t, uint32_t triIndex, int x0, int x1, int y0, int y1,
+    int tileX, int tileY, int tileSize, float* depth, uint32_t* ids)
+{
+    // spans start on an 8-pixel boundary inside the tile
+    int spanStart = tileX + ((x0 - tileX) & ~7);
+    const __m256 laneOffset = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 ex0 = _mm256_set1_ps(t.ex[0]), ex1 = _mm256_set1_ps(t.ex[1]), ex2 = _mm256_set1_ps(t.ex[2]);
+    const __m256 zx = _mm256_set1_ps(t.zx);
+    const __m256i id = _mm256_set1_epi32((int)triIndex);
+
+    for (int y = y0; y <= y1; ++y) {
+        float py = (float)y + 0.5f;
+        __m256 row0 = _mm256_set1_ps(t.ey[0] * py + t.ec[0]);
+        __m256 row1 = _mm256_set1_ps(t.ey[1] * py + t.ec[1]);
+        __m256 row2 = _mm256_set1_ps(t.ey[2] * py + t.ec[2]);
+        __m256 rowZ = _mm256_set1_ps(t.zy * py + t.zc);
+        int rowBase = (y - tileY) * tileSize - tileX;
+
+        for (int x = spanStart; x <= x1; x += 8) {
+            __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffset);
+            __m256 l0 = _mm256_add_ps(_mm256_mul_ps(ex0, px), row0);
+            __m256 l1 = _mm256_add_ps(_mm256_mul_ps(ex1, px), row1);
+            __m256 l2 = _mm256_add_ps(_mm256_mul_ps(ex2, px), row2);
+            __m256 inside = _mm256_and_ps(_mm256_and_ps(
+                _mm256_cmp_ps(l0, zero, _CMP_GE_OQ),
+                _mm256_cmp_ps(l1, zero, _CMP_GE_OQ)),
+                _mm256_cmp_ps(l2, zero, _CMP_GE_OQ));
+            if (_mm256_movemask_ps(inside) == 0) continue;
+
+            float* dp = depth + rowBase + x;
+            uint32_t* ip = ids + rowBase + x;
+            __m256 z = _mm256_add_ps(_mm256_mul_ps(zx, px), rowZ);
+            __m256 d = _mm256_loadu_ps(dp);
+            __m256 pass = _mm256_and_ps(inside, _mm256_cmp_ps(z, d, _CMP_LT_OQ));
+            if (_mm256_movemask_ps(pass) == 0) continue;
+
+            _mm256_storeu_ps(dp, _mm256_blendv_ps(d, z, pass));
+            __m256i oldIds = _mm256_loadu_si256((const __m256i*)ip);
+            __m256i newIds = _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_castsi256_ps(oldIds), _mm256_castsi256_ps(id), pass));
+            _mm256_storeu_si256((__m256i*)ip, newIds);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+//----------------------------------------------------------
+//  AVX2 VISIBILITY KERNEL
+//----------------------------------------------------------
+// The only code built for AVX2 (/arch:AVX2 on SoftRasterizerAVX2.cpp,
+// a target attribute with GCC/Clang). SoftRasterizer.cpp calls it only
+// after CPUID reports AVX2, so the rest of the backend runs on any x86-64.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SOFT_HAVE_AVX2_KERNEL 1
+#else
+#define SOFT_HAVE_AVX2_KERNEL 0
+#endif
+
+// barycentric and depth planes of one set-up triangle, see SetupTri
+struct SoftEdgePlanes {
+    float ex[3], ey[3], ec[3];
+    float zx, zy, zc;
+};
+
+#if SOFT_HAVE_AVX2_KERNEL
+// depth test [x0, x1] x [y0, y1] (already clipped to the tile) 8 pixels at
+// a time; depth/ids are tileSize x tileSize, tileSize a multiple of 8
+void softRasterizeTileAVX2(const SoftEdgePlanes& t, uint32_t triIndex, int x0, int x1, int y0, int y1,
+    int tileX, int tileY, int tileSize, float* depth, uint32_t* ids);
+#endif
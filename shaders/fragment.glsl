@@ -5,25 +5,66 @@ in vec3 vWorldPos;
 in vec3 vNormal;
 in vec3 vColor;
 in vec2 vUV;
+in float vAO;
+flat in float vLayer;
 
-uniform sampler2D uTex;
-uniform int uUseTexture;
+uniform sampler2DArray uTexArray; // one layer per material of this size
 
 uniform vec3 viewPos;
 uniform vec3 lightPos;
 uniform vec3 lightColor;
 
 uniform float ambientStrength;
+uniform vec3 uAmbientSH[9]; // sky irradiance, order 1, y, z, x, xy, yz, 3z^2-1, xz, x^2-y^2
 uniform float specStrength;
 uniform float shininess;
 
 uniform float constantAtt;
 uniform float linearAtt;
 uniform float quadraticAtt;
-uniform int uSelected;
 
-uniform int useBlinnPhong;
 uniform mat3 normalMatrix;
+
+// baked floor AO, stored in the sword's bake space
+uniform sampler2D uLightmap;
+uniform mat4 uLightmapFromWorld;
+uniform vec4 uLightmapRect; // minX, minZ, maxX, maxZ
+
+// Features are compile-time #defines injected by the application
+// (BLINN_PHONG, SELECTED, USE_TEXTURE, USE_LIGHTMAP), so every branch
+// below folds away. UBER_SHADER keeps the old runtime uniforms instead.
+#ifdef UBER_SHADER
+uniform int useBlinnPhong;
+uniform int uSelected;
+uniform int uUseTexture;
+uniform int uUseLightmap;
+#define FEATURE_BLINN_PHONG  (useBlinnPhong == 1)
+#define FEATURE_SELECTED     (uSelected == 1)
+#define FEATURE_USE_TEXTURE  (uUseTexture == 1)
+#define FEATURE_USE_LIGHTMAP (uUseLightmap == 1)
+#else
+#ifdef BLINN_PHONG
+#define FEATURE_BLINN_PHONG true
+#else
+#define FEATURE_BLINN_PHONG false
+#endif
+#ifdef SELECTED
+#define FEATURE_SELECTED true
+#else
+#define FEATURE_SELECTED false
+#endif
+#ifdef USE_TEXTURE
+#define FEATURE_USE_TEXTURE true
+#else
+#define FEATURE_USE_TEXTURE false
+#endif
+#ifdef USE_LIGHTMAP
+#define FEATURE_USE_LIGHTMAP true
+#else
+#define FEATURE_USE_LIGHTMAP false
+#endif
+#endif
+
 void main()
 {
     // --- lighting vectors ---
@@ -38,8 +79,18 @@ void main()
     // --- attenuation ---
     float att = 1.0 / (constantAtt + linearAtt * dist + quadraticAtt * dist * dist);
 
-    // --- ambient ---
-    vec3 ambient = ambientStrength * lightColor;
+    // --- ambient (baked occlusion) ---
+    float ao = vAO;
+    if (FEATURE_USE_LIGHTMAP)
+    {
+        vec2 p = (uLightmapFromWorld * vec4(vWorldPos, 1.0)).xz;
+        ao *= texture(uLightmap, (p - uLightmapRect.xy) / (uLightmapRect.zw - uLightmapRect.xy)).r;
+    }
+    vec3 sky = uAmbientSH[0]
+        + uAmbientSH[1] * N.y + uAmbientSH[2] * N.z + uAmbientSH[3] * N.x
+        + uAmbientSH[4] * (N.x * N.y) + uAmbientSH[5] * (N.y * N.z) + uAmbientSH[6] * (3.0 * N.z * N.z - 1.0)
+        + uAmbientSH[7] * (N.x * N.z) + uAmbientSH[8] * (N.x * N.x - N.y * N.y);
+    vec3 ambient = ambientStrength * ao * max(sky, vec3(0.0));
 
     // --- diffuse ---
     float diff = max(dot(N, L), 0.0);
@@ -49,7 +100,7 @@ void main()
     float spec = 0.0;
     if (diff > 0.0)
     {
-        if (useBlinnPhong == 1)
+        if (FEATURE_BLINN_PHONG)
         {
             vec3 H = normalize(L + V);
             spec = pow(max(dot(N, H), 0.0), shininess);
@@ -68,10 +119,10 @@ void main()
     // --- base color (texture OR highlight) ---
     vec3 baseColor = vColor;
 
-    if (uSelected == 1) {
+    if (FEATURE_SELECTED) {
         baseColor = vec3(1.0, 1.0, 0.2);   // bright yellow highlight
-    } else if (uUseTexture == 1) {
-        baseColor = texture(uTex, vUV).rgb;
+    } else if (FEATURE_USE_TEXTURE) {
+        baseColor = texture(uTexArray, vec3(vUV, vLayer)).rgb;
     }
 
     vec3 finalColor = baseColor * lit;
@@ -0,0 +1,15 @@
+#version 330 core
+in vec2 vCorner;
+in vec3 vColor;
+
+out vec4 FragColor;
+
+// additive blending, so no sorting and alpha is unused
+void main()
+{
+    float r2 = dot(vCorner, vCorner);
+    if (r2 > 1.0) discard;
+
+    float falloff = 1.0 - r2;
+    FragColor = vec4(vColor * falloff * falloff, 1.0);
+}
@@ -0,0 +1,40 @@
+#version 330 core
+// Instanced camera-facing quad per particle, corners from gl_VertexID
+// (4-vertex triangle strip). Per-particle state has divisor 1.
+layout(location=0) in vec4 aPosAge;
+layout(location=1) in vec4 aVelLife;
+layout(location=2) in vec2 aSeedKind;
+
+out vec2 vCorner;
+out vec3 vColor;
+
+const int MAX_EMITTERS = 8;
+uniform vec4 uEmitterColor[MAX_EMITTERS]; // rgb, a = intensity
+uniform float uEmitterSize[MAX_EMITTERS];
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    int kind = int(aSeedKind.y);
+    vec2 corner = vec2((gl_VertexID & 1) == 0 ? -1.0 : 1.0, (gl_VertexID & 2) == 0 ? -1.0 : 1.0);
+
+    float age = aPosAge.w;
+    float life = aVelLife.w;
+    float fade = 0.0;
+    if (age >= 0.0 && life > 0.0) {
+        float t = age / life;
+        fade = smoothstep(0.0, 0.1, t) * (1.0 - smoothstep(0.6, 1.0, t));
+    }
+
+    // dead / unborn particles collapse to a point and produce no fragments
+    float size = fade > 0.0 ? uEmitterSize[kind] : 0.0;
+    vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+    vec3 worldPos = aPosAge.xyz + (right * corner.x + up * corner.y) * size;
+
+    vCorner = corner;
+    vColor = uEmitterColor[kind].rgb * uEmitterColor[kind].a * fade;
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+}
@@ -0,0 +1,75 @@
+#version 330 core
+// One particle per vertex, rasterizer discarded; the result is captured
+// with transform feedback into the other ping-pong buffer.
+layout(location=0) in vec4 aPosAge;   // xyz position, w age (negative = not born yet)
+layout(location=1) in vec4 aVelLife;  // xyz velocity, w lifetime
+layout(location=2) in vec2 aSeedKind; // x random seed, y emitter index
+
+out vec4 tfPosAge;
+out vec4 tfVelLife;
+out vec2 tfSeedKind;
+
+const int MAX_EMITTERS = 8;
+uniform vec3 uEmitterPos[MAX_EMITTERS];
+uniform vec4 uEmitterVel[MAX_EMITTERS];   // xyz base velocity, w spread
+uniform vec4 uEmitterShape[MAX_EMITTERS]; // x spawn radius, y min life, z max life, w gravity
+uniform float uEmitterDrag[MAX_EMITTERS];
+
+uniform float uDeltaTime;
+uniform float uTime;
+
+uint hash(uint x)
+{
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float rand(inout uint s)
+{
+    s = hash(s);
+    return float(s >> 8) / 16777216.0;
+}
+
+vec3 randomDirection(inout uint s)
+{
+    float z = rand(s) * 2.0 - 1.0;
+    float a = rand(s) * 6.2831853;
+    float r = sqrt(max(0.0, 1.0 - z * z));
+    return vec3(r * cos(a), z, r * sin(a));
+}
+
+void main()
+{
+    int kind = int(aSeedKind.y);
+    vec3 pos = aPosAge.xyz;
+    vec3 vel = aVelLife.xyz;
+    float age = aPosAge.w + uDeltaTime;
+    float life = aVelLife.w;
+
+    if (age >= life) {
+        // respawn at the emitter's current position
+        uint s = hash(uint(gl_VertexID) ^ hash(floatBitsToUint(uTime) ^ floatBitsToUint(aSeedKind.x)));
+        pos = uEmitterPos[kind] + randomDirection(s) * uEmitterShape[kind].x * pow(rand(s), 0.333);
+        vel = uEmitterVel[kind].xyz + randomDirection(s) * uEmitterVel[kind].w * rand(s);
+        life = mix(uEmitterShape[kind].y, uEmitterShape[kind].z, rand(s));
+        age = 0.0;
+    }
+    else if (age >= 0.0) {
+        vel.y += uEmitterShape[kind].w * uDeltaTime;
+        vel *= max(0.0, 1.0 - uEmitterDrag[kind] * uDeltaTime);
+        pos += vel * uDeltaTime;
+
+        // bounce off the floor plane
+        if (pos.y < 0.0) {
+            pos.y = 0.0;
+            vel.y = -vel.y * 0.3;
+            vel.xz *= 0.7;
+        }
+    }
+
+    tfPosAge = vec4(pos, age);
+    tfVelLife = vec4(vel, life);
+    tfSeedKind = aSeedKind;
+}
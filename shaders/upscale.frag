@@ -0,0 +1,36 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 vUV;
+
+uniform sampler2D uScene;
+uniform sampler2D uSceneDepth;
+
+uniform vec2 uUVScale;    // rendered region / target size
+uniform vec2 uTexelSize;  // 1 / target size
+uniform float uSharpness; // 0 = bilinear only
+
+void main()
+{
+    // keep every bilinear tap inside the rendered region, texels past it are stale
+    vec2 uvMin = 0.5 * uTexelSize;
+    vec2 uvMax = uUVScale - 0.5 * uTexelSize;
+    vec2 uv = min(vUV * uUVScale, uvMax);
+
+    vec3 color = texture(uScene, uv).rgb;
+
+    if (uSharpness > 0.0)
+    {
+        vec2 dx = vec2(uTexelSize.x, 0.0);
+        vec2 dy = vec2(0.0, uTexelSize.y);
+        vec3 n = texture(uScene, clamp(uv + dx, uvMin, uvMax)).rgb
+               + texture(uScene, clamp(uv - dx, uvMin, uvMax)).rgb
+               + texture(uScene, clamp(uv + dy, uvMin, uvMax)).rgb
+               + texture(uScene, clamp(uv - dy, uvMin, uvMax)).rgb;
+        color = clamp(color + uSharpness * (4.0 * color - n), 0.0, 1.0);
+    }
+
+    // scene depth goes through so the skybox still fills only the background
+    gl_FragDepth = texture(uSceneDepth, uv).r;
+    FragColor = vec4(color, 1.0);
+}
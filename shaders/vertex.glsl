@@ -3,7 +3,23 @@ layout(location=0) in vec3 aPos;
 layout(location=1) in vec3 aNormal;
 layout(location=2) in vec3 aColor;
 layout(location=3) in vec2 aUV;
+layout(location=4) in float aAO;   // baked ambient occlusion
+layout(location=5) in float aLayer; // material layer in the bound texture array
+#ifdef INSTANCED
+layout(location=6) in vec4 iPosScale; // per instance: position, uniform scale
+layout(location=7) in vec4 iRotation; // per instance: cos(yaw), sin(yaw)
+#endif
+#ifdef PROCEDURAL_FLOOR
+// No vertex buffer: a square patch of uFloorCells^2 cells, two triangles
+// each, is generated from gl_VertexID around uFloorPatch.xz (the camera).
+// Normal, colour, AO and layer come from constant attributes.
+uniform vec4 uFloorPatch; // x, z centre, y height, w half size
+uniform int uFloorCells;
+const float FLOOR_UV_PER_UNIT = 0.25;
+#endif
 out vec2 vUV;
+out float vAO;
+flat out float vLayer;
 
 uniform mat4 model;
 uniform mat4 view;
@@ -15,12 +31,36 @@ out vec3 vColor;
 
 void main()
 {
-    vUV = aUV;
+#ifdef PROCEDURAL_FLOOR
+    const ivec2 corners[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+                                      ivec2(0, 0), ivec2(1, 1), ivec2(0, 1));
+    int cell = gl_VertexID / 6;
+    ivec2 grid = ivec2(cell % uFloorCells, cell / uFloorCells) + corners[gl_VertexID % 6];
+    vec2 xz = uFloorPatch.xz + (vec2(grid) / float(uFloorCells) * 2.0 - 1.0) * uFloorPatch.w;
 
+    // UVs from world position, so the texture stays put while the patch moves
+    vec4 worldPos = vec4(xz.x, uFloorPatch.y, xz.y, 1.0);
+    vWorldPos = worldPos.xyz;
+    vNormal = aNormal;
+    vUV = xz * FLOOR_UV_PER_UNIT;
+#elif defined(INSTANCED)
+    // translate * rotateY * scale, like composeModelMatrix(); the normal
+    // leaves in world space and normalMatrix is identity for these draws
+    float c = iRotation.x, s = iRotation.y;
+    vec3 p = aPos * iPosScale.w;
+    vec4 worldPos = vec4(c * p.x + s * p.z, p.y, c * p.z - s * p.x, 0.0) + vec4(iPosScale.xyz, 1.0);
+    vWorldPos = worldPos.xyz;
+    vNormal = vec3(c * aNormal.x + s * aNormal.z, aNormal.y, c * aNormal.z - s * aNormal.x);
+    vUV = aUV;
+#else
     vec4 worldPos = model * vec4(aPos, 1.0);
     vWorldPos = worldPos.xyz;
     vNormal = aNormal;      // still in model space; fragment uses normalMatrix
+    vUV = aUV;
+#endif
     vColor = aColor;
+    vAO = aAO;
+    vLayer = aLayer;
 
     gl_Position = projection * view * worldPos;
 }